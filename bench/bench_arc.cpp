@@ -0,0 +1,164 @@
+#include <common/Benchmark.h>
+#include <common/Concurrency.h>
+#include <common/Types.h>
+
+#include <rcpp/arc.h>
+#include <rcpp/aweak.h>
+#include <rcpp/rc.h>
+
+#include <memory>
+#include <thread>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+template<typename Pointer>
+void copyLoop(const Pointer &shared, std::size_t iterations)
+{
+    for (std::size_t i = 0; i < iterations; ++i) {
+        Pointer copy = shared;
+        doNotOptimize(copy);
+    }
+}
+
+template<typename Weak>
+void lockLoop(const Weak &weak, std::size_t iterations)
+{
+    for (std::size_t i = 0; i < iterations; ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+template<typename Pointer>
+void contendedCopy(State &state, std::size_t threads, const Pointer &shared)
+{
+    runConcurrently(state, threads, [&](std::size_t iterations) { copyLoop(shared, iterations); });
+}
+
+template<typename Weak>
+void contendedLock(State &state, std::size_t threads, const Weak &weak)
+{
+    runConcurrently(state, threads, [&](std::size_t iterations) { lockLoop(weak, iterations); });
+}
+
+} // namespace
+
+// The cost of atomic counting without contention.
+// Note that libstdc++'s shared_ptr only uses atomic operations once a second thread was started.
+RCPP_BENCHMARK(arc_copy, Rc)
+{
+    copyLoop(make_rc<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(arc_copy, Arc)
+{
+    copyLoop(make_arc<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(arc_copy, shared_ptr)
+{
+    copyLoop(std::make_shared<Payload>(), state.iterations());
+}
+
+// Several threads copying the same pointer, so all of them modify the same counter.
+RCPP_BENCHMARK(arc_contended_copy, Arc_1_threads)
+{
+    contendedCopy(state, 1, make_arc<Payload>());
+}
+
+RCPP_BENCHMARK(arc_contended_copy, shared_ptr_1_threads)
+{
+    contendedCopy(state, 1, std::make_shared<Payload>());
+}
+
+RCPP_BENCHMARK(arc_contended_copy, Arc_4_threads)
+{
+    contendedCopy(state, 4, make_arc<Payload>());
+}
+
+RCPP_BENCHMARK(arc_contended_copy, shared_ptr_4_threads)
+{
+    contendedCopy(state, 4, std::make_shared<Payload>());
+}
+
+RCPP_BENCHMARK(arc_contended_copy, Arc_16_threads)
+{
+    contendedCopy(state, 16, make_arc<Payload>());
+}
+
+RCPP_BENCHMARK(arc_contended_copy, shared_ptr_16_threads)
+{
+    contendedCopy(state, 16, std::make_shared<Payload>());
+}
+
+// Upgrading weak references, which needs a compare-and-swap loop.
+RCPP_BENCHMARK(arc_contended_lock, AWeak_1_threads)
+{
+    const auto shared = make_arc<Payload>();
+    contendedLock(state, 1, AWeak<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, weak_ptr_1_threads)
+{
+    const auto shared = std::make_shared<Payload>();
+    contendedLock(state, 1, std::weak_ptr<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, AWeak_4_threads)
+{
+    const auto shared = make_arc<Payload>();
+    contendedLock(state, 4, AWeak<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, weak_ptr_4_threads)
+{
+    const auto shared = std::make_shared<Payload>();
+    contendedLock(state, 4, std::weak_ptr<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, AWeak_16_threads)
+{
+    const auto shared = make_arc<Payload>();
+    contendedLock(state, 16, AWeak<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, weak_ptr_16_threads)
+{
+    const auto shared = std::make_shared<Payload>();
+    contendedLock(state, 16, std::weak_ptr<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, AWeak_32_threads)
+{
+    const auto shared = make_arc<Payload>();
+    contendedLock(state, 32, AWeak<Payload>(shared));
+}
+
+RCPP_BENCHMARK(arc_contended_lock, weak_ptr_32_threads)
+{
+    const auto shared = std::make_shared<Payload>();
+    contendedLock(state, 32, std::weak_ptr<Payload>(shared));
+}
+
+// Creating and dropping a value. Without weak references, the last release of an Arc frees the
+// block after a single atomic operation.
+RCPP_BENCHMARK(arc_make_destroy, Arc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto arc = make_arc<Payload>(static_cast<int>(i));
+        doNotOptimize(arc);
+    }
+}
+
+RCPP_BENCHMARK(arc_make_destroy, shared_ptr)
+{
+    // make sure shared_ptr uses atomic operations as well
+    std::thread([] {}).join();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto shared = std::make_shared<Payload>(static_cast<int>(i));
+        doNotOptimize(shared);
+    }
+}
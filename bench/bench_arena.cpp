@@ -0,0 +1,55 @@
+#include <common/Benchmark.h>
+
+#include <rcpp/rc.h>
+
+#include <memory>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Number of nodes in the graph of a single simulated request.
+constexpr int RequestNodes = 4096;
+
+struct Node {
+    int value = 0;
+    Rc<Node> next;
+};
+
+// Builds a list of nodes and tears it down again, like a request-scoped object graph.
+void buildRequestGraph()
+{
+    Rc<Node> head;
+    for (int i = 0; i < RequestNodes; ++i) {
+        auto node = make_rc<Node>();
+        node->value = i;
+        node->next = std::move(head);
+        head = std::move(node);
+    }
+    doNotOptimize(head);
+
+    // unlink iteratively, so destruction does not recurse
+    while (head) {
+        head = Rc<Node>(head->next);
+    }
+}
+
+} // namespace
+
+RCPP_BENCHMARK(arena_request, make_rc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        buildRequestGraph();
+    }
+    state.setCounter("nodes_per_iteration", RequestNodes);
+}
+
+RCPP_BENCHMARK(arena_request, RcArena)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        RcArena arena;
+        buildRequestGraph();
+    }
+    state.setCounter("nodes_per_iteration", RequestNodes);
+}
@@ -0,0 +1,161 @@
+#include <common/Benchmark.h>
+
+#include <rcpp/rc_array.h>
+#include <rcpp/rc_trailing.h>
+
+#include <memory>
+#include <vector>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Many small shared arrays, like the token lists of parsed documents.
+constexpr std::size_t Arrays = 4096;
+constexpr std::size_t ArraySize = 16;
+
+template<typename Array, typename Factory>
+void sumArrays(State &state, Factory factory)
+{
+    std::vector<Array> arrays;
+    arrays.reserve(Arrays);
+    for (std::size_t i = 0; i < Arrays; ++i) {
+        arrays.push_back(factory());
+    }
+
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        int sum = 0;
+        for (const auto &array : arrays) {
+            for (int element : *array) {
+                sum += element;
+            }
+        }
+        doNotOptimize(sum);
+    }
+    state.setCounter("elements_per_iteration", Arrays * ArraySize);
+}
+
+// Rc<T[]> has no operator*, so provide the same interface as the pointers to vectors.
+struct RcArrayRef {
+    const Rc<int[]> &array;
+
+    const int *begin() const
+    {
+        return array.begin();
+    }
+
+    const int *end() const
+    {
+        return array.end();
+    }
+};
+
+struct RcArray {
+    Rc<int[]> array;
+
+    RcArrayRef operator*() const
+    {
+        return { array };
+    }
+};
+
+} // namespace
+
+RCPP_BENCHMARK(array_sum, Rc_array)
+{
+    sumArrays<RcArray>(state, [] { return RcArray{ make_rc_array<int>(ArraySize, 1) }; });
+}
+
+RCPP_BENCHMARK(array_sum, Rc_vector)
+{
+    sumArrays<Rc<std::vector<int>>>(state, [] { return make_rc<std::vector<int>>(ArraySize, 1); });
+}
+
+RCPP_BENCHMARK(array_sum, shared_ptr_array)
+{
+    sumArrays<std::shared_ptr<std::vector<int>>>(state, [] { return std::make_shared<std::vector<int>>(ArraySize, 1); });
+}
+
+RCPP_BENCHMARK(array_make, Rc_array)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto array = make_rc_array<int>(ArraySize, 1);
+        doNotOptimize(array);
+    }
+}
+
+RCPP_BENCHMARK(array_make, Rc_vector)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto array = make_rc<std::vector<int>>(ArraySize, 1);
+        doNotOptimize(array);
+    }
+}
+
+namespace {
+
+struct EntryHeader {
+    int kind = 0;
+};
+
+struct EntryWithVector {
+    int kind = 0;
+    std::vector<int> entries;
+};
+
+} // namespace
+
+RCPP_BENCHMARK(trailing_make, make_rc_with_trailing)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto node = make_rc_with_trailing<EntryHeader, int>(ArraySize);
+        doNotOptimize(node);
+    }
+}
+
+RCPP_BENCHMARK(trailing_make, Rc_with_vector)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto node = make_rc<EntryWithVector>(EntryWithVector{ 0, std::vector<int>(ArraySize) });
+        doNotOptimize(node);
+    }
+}
+
+RCPP_BENCHMARK(trailing_sum, make_rc_with_trailing)
+{
+    std::vector<Rc<RcTrailing<EntryHeader, int>>> nodes;
+    for (std::size_t i = 0; i < Arrays; ++i) {
+        nodes.push_back(make_rc_with_trailing<EntryHeader, int>(ArraySize));
+    }
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        int sum = 0;
+        for (const auto &node : nodes) {
+            sum += node->kind;
+            for (int entry : node.trailing()) {
+                sum += entry;
+            }
+        }
+        doNotOptimize(sum);
+    }
+    state.setCounter("elements_per_iteration", Arrays * ArraySize);
+}
+
+RCPP_BENCHMARK(trailing_sum, Rc_with_vector)
+{
+    std::vector<Rc<EntryWithVector>> nodes;
+    for (std::size_t i = 0; i < Arrays; ++i) {
+        nodes.push_back(make_rc<EntryWithVector>(EntryWithVector{ 0, std::vector<int>(ArraySize) }));
+    }
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        int sum = 0;
+        for (const auto &node : nodes) {
+            sum += node->kind;
+            for (int entry : node->entries) {
+                sum += entry;
+            }
+        }
+        doNotOptimize(sum);
+    }
+    state.setCounter("elements_per_iteration", Arrays * ArraySize);
+}
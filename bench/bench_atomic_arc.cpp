@@ -0,0 +1,132 @@
+#include <common/Benchmark.h>
+#include <common/Concurrency.h>
+#include <common/Types.h>
+
+#include <rcpp/atomic_arc.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// std::atomic<std::shared_ptr> needs C++20, fall back to the atomic free functions of C++11
+class AtomicSharedPtr
+{
+public:
+    std::shared_ptr<Payload> load() const
+    {
+#ifdef __cpp_lib_atomic_shared_ptr
+        return m_pointer.load();
+#else
+        return std::atomic_load(&m_pointer);
+#endif
+    }
+
+    void store(std::shared_ptr<Payload> pointer)
+    {
+#ifdef __cpp_lib_atomic_shared_ptr
+        m_pointer.store(std::move(pointer));
+#else
+        std::atomic_store(&m_pointer, std::move(pointer));
+#endif
+    }
+
+private:
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<std::shared_ptr<Payload>> m_pointer;
+#else
+    std::shared_ptr<Payload> m_pointer;
+#endif
+};
+
+class MutexSharedPtr
+{
+public:
+    std::shared_ptr<Payload> load() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_pointer;
+    }
+
+    void store(std::shared_ptr<Payload> pointer)
+    {
+        std::lock_guard lock(m_mutex);
+        m_pointer.swap(pointer);
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::shared_ptr<Payload> m_pointer;
+};
+
+// Every thread loads the published value and reads it, one in 1024 iterations publishes a new one.
+template<typename Cell, typename Make>
+void readMostly(State &state, std::size_t threads, Make make)
+{
+    Cell cell;
+    cell.store(make(0));
+    runConcurrently(state, threads, [&](std::size_t iterations) {
+        for (std::size_t i = 1; i <= iterations; ++i) {
+            if (i % 1024 == 0) {
+                cell.store(make(static_cast<int>(i)));
+            } else {
+                auto loaded = cell.load();
+                doNotOptimize(loaded->value);
+            }
+        }
+    });
+}
+
+auto makeArc = [](int value) { return make_arc<Payload>(value); };
+auto makeShared = [](int value) { return std::make_shared<Payload>(value); };
+
+} // namespace
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, AtomicArc_1_threads)
+{
+    readMostly<AtomicArc<Payload>>(state, 1, makeArc);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, atomic_shared_ptr_1_threads)
+{
+    readMostly<AtomicSharedPtr>(state, 1, makeShared);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, mutex_shared_ptr_1_threads)
+{
+    readMostly<MutexSharedPtr>(state, 1, makeShared);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, AtomicArc_4_threads)
+{
+    readMostly<AtomicArc<Payload>>(state, 4, makeArc);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, atomic_shared_ptr_4_threads)
+{
+    readMostly<AtomicSharedPtr>(state, 4, makeShared);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, mutex_shared_ptr_4_threads)
+{
+    readMostly<MutexSharedPtr>(state, 4, makeShared);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, AtomicArc_16_threads)
+{
+    readMostly<AtomicArc<Payload>>(state, 16, makeArc);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, atomic_shared_ptr_16_threads)
+{
+    readMostly<AtomicSharedPtr>(state, 16, makeShared);
+}
+
+RCPP_BENCHMARK(atomic_cell_read_mostly, mutex_shared_ptr_16_threads)
+{
+    readMostly<MutexSharedPtr>(state, 16, makeShared);
+}
@@ -0,0 +1,103 @@
+#include <common/Benchmark.h>
+#include <common/Concurrency.h>
+#include <common/Types.h>
+
+#include <rcpp/arc.h>
+#include <rcpp/brc.h>
+#include <rcpp/rc.h>
+
+#include <memory>
+#include <thread>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+template<typename Pointer>
+void copyLoop(const Pointer &shared, std::size_t iterations)
+{
+    for (std::size_t i = 0; i < iterations; ++i) {
+        Pointer copy = shared;
+        doNotOptimize(copy);
+    }
+}
+
+template<typename Make>
+void makeDestroyLoop(State &state, Make make)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto pointer = make(static_cast<int>(i));
+        doNotOptimize(pointer);
+    }
+}
+
+// libstdc++'s shared_ptr only uses atomic operations once a second thread was started
+void startThread()
+{
+    std::thread([] {}).join();
+}
+
+} // namespace
+
+// Copies on the thread that created the value, the common case that biased counting optimizes.
+RCPP_BENCHMARK(brc_owner_copy, Rc)
+{
+    copyLoop(make_rc<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(brc_owner_copy, Brc)
+{
+    copyLoop(make_brc<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(brc_owner_copy, Arc)
+{
+    copyLoop(make_arc<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(brc_owner_copy, shared_ptr)
+{
+    startThread();
+    copyLoop(std::make_shared<Payload>(), state.iterations());
+}
+
+RCPP_BENCHMARK(brc_owner_make_destroy, Rc)
+{
+    makeDestroyLoop(state, [](int i) { return make_rc<Payload>(i); });
+}
+
+RCPP_BENCHMARK(brc_owner_make_destroy, Brc)
+{
+    makeDestroyLoop(state, [](int i) { return make_brc<Payload>(i); });
+}
+
+RCPP_BENCHMARK(brc_owner_make_destroy, Arc)
+{
+    makeDestroyLoop(state, [](int i) { return make_arc<Payload>(i); });
+}
+
+RCPP_BENCHMARK(brc_owner_make_destroy, shared_ptr)
+{
+    startThread();
+    makeDestroyLoop(state, [](int i) { return std::make_shared<Payload>(i); });
+}
+
+// Copies on 4 other threads, which all use the atomic count.
+RCPP_BENCHMARK(brc_shared_copy, Brc)
+{
+    const auto shared = make_brc<Payload>();
+    runConcurrently(state, 4, [&](std::size_t iterations) { copyLoop(shared, iterations); });
+}
+
+RCPP_BENCHMARK(brc_shared_copy, Arc)
+{
+    const auto shared = make_arc<Payload>();
+    runConcurrently(state, 4, [&](std::size_t iterations) { copyLoop(shared, iterations); });
+}
+
+RCPP_BENCHMARK(brc_shared_copy, shared_ptr)
+{
+    const auto shared = std::make_shared<Payload>();
+    runConcurrently(state, 4, [&](std::size_t iterations) { copyLoop(shared, iterations); });
+}
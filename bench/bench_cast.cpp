@@ -0,0 +1,83 @@
+#include <common/Benchmark.h>
+#include <common/Types.h>
+
+#include <rcpp/prc.h>
+
+#include <memory>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+RCPP_BENCHMARK(static_pointer_cast, Prc)
+{
+    auto prc = make_prc<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto base = static_pointer_cast<PolymorphicBase>(prc);
+        doNotOptimize(base);
+    }
+}
+
+RCPP_BENCHMARK(static_pointer_cast, shared_ptr)
+{
+    auto ptr = std::make_shared<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto base = std::static_pointer_cast<PolymorphicBase>(ptr);
+        doNotOptimize(base);
+    }
+}
+
+RCPP_BENCHMARK(static_pointer_cast_from_rc, Rc)
+{
+    auto rc = make_rc<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto base = static_pointer_cast<PolymorphicBase>(rc);
+        doNotOptimize(base);
+    }
+}
+
+RCPP_BENCHMARK(static_pointer_cast_from_rc, shared_ptr)
+{
+    auto ptr = std::make_shared<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto base = std::static_pointer_cast<PolymorphicBase>(ptr);
+        doNotOptimize(base);
+    }
+}
+
+RCPP_BENCHMARK(dynamic_pointer_cast, Prc)
+{
+    auto prc = static_pointer_cast<PolymorphicBase>(make_prc<PolymorphicDerived>());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto derived = dynamic_pointer_cast<PolymorphicDerived>(prc);
+        doNotOptimize(derived);
+    }
+}
+
+RCPP_BENCHMARK(dynamic_pointer_cast, shared_ptr)
+{
+    std::shared_ptr<PolymorphicBase> ptr = std::make_shared<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto derived = std::dynamic_pointer_cast<PolymorphicDerived>(ptr);
+        doNotOptimize(derived);
+    }
+}
+
+// std::shared_ptr has no equivalent to casting back to a single pointer type,
+// so compare against the closest operation, a dynamic_pointer_cast to the concrete type.
+RCPP_BENCHMARK(dynamic_base_pointer_cast, Prc)
+{
+    auto prc = static_pointer_cast<PolymorphicBase>(make_prc<PolymorphicDerived>());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        Rc<PolymorphicDerived> derived = dynamic_base_pointer_cast<PolymorphicDerived>(prc);
+        doNotOptimize(derived);
+    }
+}
+
+RCPP_BENCHMARK(dynamic_base_pointer_cast, shared_ptr)
+{
+    std::shared_ptr<PolymorphicBase> ptr = std::make_shared<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto derived = std::dynamic_pointer_cast<PolymorphicDerived>(ptr);
+        doNotOptimize(derived);
+    }
+}
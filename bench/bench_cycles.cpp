@@ -0,0 +1,110 @@
+#include <common/Benchmark.h>
+
+#include <rcpp/cycles.h>
+
+#include <vector>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+constexpr int RingSize = 16;
+
+struct TracedNode {
+    int value = 0;
+    Rc<TracedNode> next;
+
+    void trace(RcTracer &tracer) const
+    {
+        tracer(next);
+    }
+};
+
+struct UntracedNode {
+    int value = 0;
+    Rc<UntracedNode> next;
+};
+
+// Builds a ring of RingSize nodes and returns one of them.
+template<typename Node>
+Rc<Node> makeRing()
+{
+    auto first = make_rc<Node>();
+    auto last = first;
+    for (int i = 1; i < RingSize; ++i) {
+        auto node = make_rc<Node>();
+        node->value = i;
+        last->next = node;
+        last = node;
+    }
+    last->next = first;
+    return first;
+}
+
+} // namespace
+
+// Cyclic graphs that are created and dropped repeatedly.
+// The baseline breaks the cycle by hand before dropping it, which needs knowledge of the graph.
+RCPP_BENCHMARK(cycle_churn, manual_break)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ring = makeRing<UntracedNode>();
+        doNotOptimize(ring);
+        ring->next.reset();
+    }
+    state.setCounter("nodes_per_iteration", RingSize);
+}
+
+RCPP_BENCHMARK(cycle_churn, collect_cycles)
+{
+    std::size_t collected = 0;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        {
+            auto ring = makeRing<TracedNode>();
+            doNotOptimize(ring);
+        }
+        collected += collect_cycles();
+    }
+    state.setCounter("nodes_per_iteration", RingSize);
+    state.setCounter("collected_per_iteration", static_cast<double>(collected) / state.iterations());
+}
+
+RCPP_BENCHMARK(cycle_churn, collect_cycles_batched)
+{
+    constexpr std::size_t Batch = 64;
+    std::size_t collected = 0;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        {
+            auto ring = makeRing<TracedNode>();
+            doNotOptimize(ring);
+        }
+        if (i % Batch == Batch - 1) {
+            collected += collect_cycles();
+        }
+    }
+    collected += collect_cycles();
+    state.setCounter("nodes_per_iteration", RingSize);
+    state.setCounter("collected_per_iteration", static_cast<double>(collected) / state.iterations());
+}
+
+// The cost of a copy that is dropped again. Types that do not opt in to tracing pay nothing,
+// traceable types buffer the value as a possible root of a cycle.
+RCPP_BENCHMARK(cycle_copy, untraced)
+{
+    auto node = make_rc<UntracedNode>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto copy = node;
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(cycle_copy, traced)
+{
+    auto node = make_rc<TracedNode>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto copy = node;
+        doNotOptimize(copy);
+    }
+    collect_cycles();
+}
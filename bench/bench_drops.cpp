@@ -0,0 +1,131 @@
+#include <common/Benchmark.h>
+
+#include <rcpp/rc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Every tick of the simulated event loop creates a chain of NodesPerTick nodes.
+// Every DropInterval ticks, all chains are dropped at once.
+constexpr int NodesPerTick = 64;
+constexpr std::size_t DropInterval = 256;
+constexpr std::size_t DrainBudget = 4 * NodesPerTick;
+
+struct Node {
+    int value = 0;
+    Rc<Node> next;
+};
+
+Rc<Node> makeChain()
+{
+    Rc<Node> head;
+    for (int i = 0; i < NodesPerTick; ++i) {
+        auto node = make_rc<Node>();
+        node->value = i;
+        node->next = std::move(head);
+        head = std::move(node);
+    }
+    return head;
+}
+
+void reportLatency(State &state, std::vector<double> &ticks)
+{
+    std::sort(ticks.begin(), ticks.end());
+    const auto percentile = [&](double p) {
+        return ticks[std::min(ticks.size() - 1, static_cast<std::size_t>(p * ticks.size()))];
+    };
+    state.setCounter("tick_p50_ns", percentile(0.5));
+    state.setCounter("tick_p99_ns", percentile(0.99));
+    state.setCounter("tick_p999_ns", percentile(0.999));
+    state.setCounter("tick_max_ns", ticks.back());
+}
+
+template<typename Drain>
+void eventLoop(State &state, Drain drain)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Rc<Node>> scene;
+    std::vector<double> ticks;
+    ticks.reserve(state.iterations());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        const auto start = Clock::now();
+        scene.push_back(makeChain());
+        if (i % DropInterval == DropInterval - 1) {
+            scene.clear();
+        }
+        drain();
+        ticks.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    scene.clear();
+    reportLatency(state, ticks);
+}
+
+} // namespace
+
+// Tail latency of the ticks of an event loop that periodically drops a large graph.
+RCPP_BENCHMARK(drop_latency, immediate)
+{
+    eventLoop(state, [] {});
+}
+
+RCPP_BENCHMARK(drop_latency, deferred)
+{
+    RcDeferredDrops deferred;
+    eventLoop(state, [] { drain_drops(DrainBudget); });
+}
+
+RCPP_BENCHMARK(drop_latency, deferred_time_slice)
+{
+    RcDeferredDrops deferred;
+    eventLoop(state, [] { drain_drops(std::chrono::microseconds(4)); });
+}
+
+namespace {
+
+constexpr int ChainLength = 100'000;
+
+Rc<Node> makeLongChain()
+{
+    Rc<Node> head;
+    for (int n = 0; n < ChainLength; ++n) {
+        auto node = make_rc<Node>();
+        node->next = std::move(head);
+        head = std::move(node);
+    }
+    return head;
+}
+
+} // namespace
+
+// Dropping a long list, whose nested releases are trampolined once they are deeper than the limit of RcDropQueue.
+RCPP_BENCHMARK(drop_chain, reset)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto head = makeLongChain();
+        state.startTiming();
+        head.reset();
+        state.stopTiming();
+    }
+    state.setCounter("nodes_per_iteration", ChainLength);
+}
+
+// The usual workaround without trampolining: unlinking the nodes one by one.
+RCPP_BENCHMARK(drop_chain, manual_unlink)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto head = makeLongChain();
+        state.startTiming();
+        while (head) {
+            head = std::move(head->next);
+        }
+        state.stopTiming();
+    }
+    state.setCounter("nodes_per_iteration", ChainLength);
+}
@@ -0,0 +1,98 @@
+#include <common/Benchmark.h>
+#include <common/Concurrency.h>
+#include <common/Types.h>
+
+#include <rcpp/atomic_arc.h>
+#include <rcpp/epoch_arc.h>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Every thread reads the value published in a shared cell. The time per iteration is the inverse of
+// the total read throughput, so it drops with the number of threads as long as reads scale.
+void borrowedReads(State &state, std::size_t threads)
+{
+    AtomicEpochArc<Payload> cell(make_epoch_arc<Payload>(1));
+    runConcurrently(state, threads, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            EpochGuard guard;
+            doNotOptimize(cell.read(guard)->value);
+        }
+    });
+}
+
+template<typename Cell, typename Pointer>
+void countedReads(State &state, std::size_t threads, Pointer pointer)
+{
+    Cell cell(std::move(pointer));
+    runConcurrently(state, threads, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            auto loaded = cell.load();
+            doNotOptimize(loaded->value);
+        }
+    });
+}
+
+} // namespace
+
+RCPP_BENCHMARK(epoch_read_scaling, EpochGuard_1_threads)
+{
+    borrowedReads(state, 1);
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicEpochArc_load_1_threads)
+{
+    countedReads<AtomicEpochArc<Payload>>(state, 1, make_epoch_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicArc_load_1_threads)
+{
+    countedReads<AtomicArc<Payload>>(state, 1, make_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, EpochGuard_4_threads)
+{
+    borrowedReads(state, 4);
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicEpochArc_load_4_threads)
+{
+    countedReads<AtomicEpochArc<Payload>>(state, 4, make_epoch_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicArc_load_4_threads)
+{
+    countedReads<AtomicArc<Payload>>(state, 4, make_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, EpochGuard_16_threads)
+{
+    borrowedReads(state, 16);
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicEpochArc_load_16_threads)
+{
+    countedReads<AtomicEpochArc<Payload>>(state, 16, make_epoch_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicArc_load_16_threads)
+{
+    countedReads<AtomicArc<Payload>>(state, 16, make_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, EpochGuard_64_threads)
+{
+    borrowedReads(state, 64);
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicEpochArc_load_64_threads)
+{
+    countedReads<AtomicEpochArc<Payload>>(state, 64, make_epoch_arc<Payload>(1));
+}
+
+RCPP_BENCHMARK(epoch_read_scaling, AtomicArc_load_64_threads)
+{
+    countedReads<AtomicArc<Payload>>(state, 64, make_arc<Payload>(1));
+}
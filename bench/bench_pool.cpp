@@ -0,0 +1,76 @@
+#include <common/Benchmark.h>
+#include <common/Types.h>
+
+#include <rcpp/pool.h>
+
+#include <memory>
+#include <vector>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Number of values that are alive at the same time in the churn benchmarks.
+constexpr std::size_t LiveNodes = 4096;
+
+template<typename Factory>
+void churn(State &state, Factory factory)
+{
+    std::vector<decltype(factory(0))> nodes(LiveNodes);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        // replace the nodes in a scattered order, so the allocator cannot just reuse the last freed block
+        nodes[(i * 2654435761u) % LiveNodes] = factory(static_cast<int>(i));
+    }
+}
+
+} // namespace
+
+RCPP_BENCHMARK(pool_make, make_rc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc<Payload>(static_cast<int>(i));
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(pool_make, make_rc_pooled)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc_pooled<Payload>(static_cast<int>(i));
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(pool_make, make_shared)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ptr = std::make_shared<Payload>(static_cast<int>(i));
+        doNotOptimize(ptr);
+    }
+}
+
+RCPP_BENCHMARK(pool_churn, make_rc)
+{
+    churn(state, [](int value) { return make_rc<Payload>(value); });
+}
+
+RCPP_BENCHMARK(pool_churn, make_rc_pooled)
+{
+    churn(state, [](int value) { return make_rc_pooled<Payload>(value); });
+}
+
+RCPP_BENCHMARK(pool_churn, make_shared)
+{
+    churn(state, [](int value) { return std::make_shared<Payload>(value); });
+}
+
+RCPP_BENCHMARK(pool_destroy, make_rc)
+{
+    measureDestruction<Rc<Payload>>(state, [] { return make_rc<Payload>(); });
+}
+
+RCPP_BENCHMARK(pool_destroy, make_rc_pooled)
+{
+    measureDestruction<Rc<Payload>>(state, [] { return make_rc_pooled<Payload>(); });
+}
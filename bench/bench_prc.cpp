@@ -0,0 +1,122 @@
+#include <common/Benchmark.h>
+#include <common/Types.h>
+
+#include <rcpp/intrusive_rc.h>
+#include <rcpp/prc.h>
+
+#include <memory>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+RCPP_BENCHMARK(prc_make, Prc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto prc = make_prc<PolymorphicDerived>();
+        doNotOptimize(prc);
+    }
+}
+
+RCPP_BENCHMARK(prc_make, IntrusiveRc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_intrusive_rc<IntrusiveDerived>();
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(prc_make, shared_ptr)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ptr = std::make_shared<PolymorphicDerived>();
+        doNotOptimize(ptr);
+    }
+}
+
+RCPP_BENCHMARK(prc_copy, Prc)
+{
+    auto prc = make_prc<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        Prc<PolymorphicDerived> copy(prc);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(prc_copy, IntrusiveRc)
+{
+    auto rc = make_intrusive_rc<IntrusiveDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        IntrusiveRc<IntrusiveDerived> copy(rc);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(prc_copy, shared_ptr)
+{
+    auto ptr = std::make_shared<PolymorphicDerived>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        std::shared_ptr<PolymorphicDerived> copy(ptr);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(prc_move, Prc)
+{
+    auto first = make_prc<PolymorphicDerived>();
+    Prc<PolymorphicDerived> second;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        second = std::move(first);
+        doNotOptimize(second);
+        first = std::move(second);
+        doNotOptimize(first);
+    }
+}
+
+RCPP_BENCHMARK(prc_move, shared_ptr)
+{
+    auto first = std::make_shared<PolymorphicDerived>();
+    std::shared_ptr<PolymorphicDerived> second;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        second = std::move(first);
+        doNotOptimize(second);
+        first = std::move(second);
+        doNotOptimize(first);
+    }
+}
+
+RCPP_BENCHMARK(prc_assign, Prc)
+{
+    auto first = make_prc<PolymorphicDerived>();
+    auto second = make_prc<PolymorphicDerived>();
+    Prc<PolymorphicDerived> target;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        target = (i & 1) ? first : second;
+        doNotOptimize(target);
+    }
+}
+
+RCPP_BENCHMARK(prc_assign, shared_ptr)
+{
+    auto first = std::make_shared<PolymorphicDerived>();
+    auto second = std::make_shared<PolymorphicDerived>();
+    std::shared_ptr<PolymorphicDerived> target;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        target = (i & 1) ? first : second;
+        doNotOptimize(target);
+    }
+}
+
+RCPP_BENCHMARK(prc_destroy, Prc)
+{
+    measureDestruction<Prc<PolymorphicBase>>(state, [] { return static_pointer_cast<PolymorphicBase>(make_prc<PolymorphicDerived>()); });
+}
+
+RCPP_BENCHMARK(prc_destroy, IntrusiveRc)
+{
+    measureDestruction<IntrusiveRc<IntrusiveBase>>(state, [] { return IntrusiveRc<IntrusiveBase>(make_intrusive_rc<IntrusiveDerived>()); });
+}
+
+RCPP_BENCHMARK(prc_destroy, shared_ptr)
+{
+    measureDestruction<std::shared_ptr<PolymorphicBase>>(state, [] { return std::static_pointer_cast<PolymorphicBase>(std::make_shared<PolymorphicDerived>()); });
+}
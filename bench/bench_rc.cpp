@@ -0,0 +1,263 @@
+#include <common/Benchmark.h>
+#include <common/Types.h>
+
+#include <rcpp/rc.h>
+#include <rcpp/rc_strong_only.h>
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <vector>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+// Records the size of the allocations done by std::allocate_shared.
+template<typename T>
+struct SizeRecordingAllocator {
+    using value_type = T;
+
+    explicit SizeRecordingAllocator(std::size_t &bytes)
+        : bytes(&bytes)
+    {
+    }
+
+    template<typename U>
+    SizeRecordingAllocator(const SizeRecordingAllocator<U> &other)
+        : bytes(other.bytes)
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        *bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *pointer, std::size_t n)
+    {
+        std::allocator<T>().deallocate(pointer, n);
+    }
+
+    std::size_t *bytes;
+};
+
+template<typename T>
+std::size_t sharedPtrAllocationSize()
+{
+    std::size_t bytes = 0;
+    std::allocate_shared<T>(SizeRecordingAllocator<T>(bytes));
+    return bytes;
+}
+
+} // namespace
+
+RCPP_BENCHMARK(rc_make, Rc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc<Payload>(static_cast<int>(i));
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(rc_make, shared_ptr)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ptr = std::make_shared<Payload>(static_cast<int>(i));
+        doNotOptimize(ptr);
+    }
+}
+
+RCPP_BENCHMARK(rc_copy, Rc)
+{
+    auto rc = make_rc<Payload>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        Rc<Payload> copy(rc);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(rc_copy, shared_ptr)
+{
+    auto ptr = std::make_shared<Payload>();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        std::shared_ptr<Payload> copy(ptr);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(rc_move, Rc)
+{
+    auto first = make_rc<Payload>();
+    Rc<Payload> second;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        second = std::move(first);
+        doNotOptimize(second);
+        first = std::move(second);
+        doNotOptimize(first);
+    }
+}
+
+RCPP_BENCHMARK(rc_move, shared_ptr)
+{
+    auto first = std::make_shared<Payload>();
+    std::shared_ptr<Payload> second;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        second = std::move(first);
+        doNotOptimize(second);
+        first = std::move(second);
+        doNotOptimize(first);
+    }
+}
+
+RCPP_BENCHMARK(rc_assign, Rc)
+{
+    auto first = make_rc<Payload>(1);
+    auto second = make_rc<Payload>(2);
+    Rc<Payload> target;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        target = (i & 1) ? first : second;
+        doNotOptimize(target);
+    }
+}
+
+RCPP_BENCHMARK(rc_assign, shared_ptr)
+{
+    auto first = std::make_shared<Payload>(1);
+    auto second = std::make_shared<Payload>(2);
+    std::shared_ptr<Payload> target;
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        target = (i & 1) ? first : second;
+        doNotOptimize(target);
+    }
+}
+
+RCPP_BENCHMARK(rc_destroy, Rc)
+{
+    measureDestruction<Rc<Payload>>(state, [] { return make_rc<Payload>(); });
+}
+
+RCPP_BENCHMARK(rc_destroy, RcStrongOnly)
+{
+    measureDestruction<RcStrongOnly<Payload>>(state, [] { return make_rc_strong_only<Payload>(); });
+}
+
+RCPP_BENCHMARK(rc_destroy, shared_ptr)
+{
+    measureDestruction<std::shared_ptr<Payload>>(state, [] { return std::make_shared<Payload>(); });
+}
+
+// Creates and immediately destroys a value, reporting the size of the allocation.
+RCPP_BENCHMARK(rc_make_destroy, Rc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc<Payload>(static_cast<int>(i));
+        doNotOptimize(rc);
+        rc.reset();
+    }
+    state.setCounter("allocation_bytes", sizeof(RcValue<Payload, std::size_t>));
+}
+
+RCPP_BENCHMARK(rc_make_destroy, Rc_uint32)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = Rc<Payload, std::uint32_t>::make(static_cast<int>(i));
+        doNotOptimize(rc);
+        rc.reset();
+    }
+    state.setCounter("allocation_bytes", sizeof(RcValue<Payload, std::uint32_t>));
+}
+
+RCPP_BENCHMARK(rc_make_destroy, Rc_uint16)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = Rc<Payload, std::uint16_t>::make(static_cast<int>(i));
+        doNotOptimize(rc);
+        rc.reset();
+    }
+    state.setCounter("allocation_bytes", sizeof(RcValue<Payload, std::uint16_t>));
+}
+
+RCPP_BENCHMARK(rc_make_destroy, RcStrongOnly)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc_strong_only<Payload>(static_cast<int>(i));
+        doNotOptimize(rc);
+        rc.reset();
+    }
+    state.setCounter("allocation_bytes", sizeof(RcStrongValue<Payload, std::size_t>));
+}
+
+RCPP_BENCHMARK(rc_make_destroy, shared_ptr)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ptr = std::make_shared<Payload>(static_cast<int>(i));
+        doNotOptimize(ptr);
+        ptr.reset();
+    }
+    state.setCounter("allocation_bytes", sharedPtrAllocationSize<Payload>());
+}
+
+// Creates short lived copies of many values, the typical pattern of passing shared nodes around.
+template<typename Pointer, typename Factory>
+static void copyChurn(State &state, Factory factory)
+{
+    constexpr std::size_t Values = 1024;
+    std::vector<Pointer> values;
+    for (std::size_t i = 0; i < Values; ++i) {
+        values.push_back(factory());
+    }
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto &value = values[i % Values];
+        // replace every value once in a while
+        if (i % 8 == 0) {
+            value = factory();
+        }
+        Pointer copy(value);
+        doNotOptimize(copy);
+    }
+}
+
+RCPP_BENCHMARK(rc_copy_churn, Rc)
+{
+    copyChurn<Rc<Payload>>(state, [] { return make_rc<Payload>(); });
+}
+
+RCPP_BENCHMARK(rc_copy_churn, RcStrongOnly)
+{
+    copyChurn<RcStrongOnly<Payload>>(state, [] { return make_rc_strong_only<Payload>(); });
+}
+
+RCPP_BENCHMARK(rc_copy_churn, shared_ptr)
+{
+    copyChurn<std::shared_ptr<Payload>>(state, [] { return std::make_shared<Payload>(); });
+}
+
+// A buffer that is filled from I/O right after its creation.
+using SampleBlock = std::array<float, 4096>;
+
+RCPP_BENCHMARK(rc_make_buffer, make_rc)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc<SampleBlock>();
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(rc_make_buffer, make_rc_for_overwrite)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto rc = make_rc_for_overwrite<SampleBlock>();
+        doNotOptimize(rc);
+    }
+}
+
+RCPP_BENCHMARK(rc_make_buffer, shared_ptr)
+{
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto ptr = std::make_shared<SampleBlock>();
+        doNotOptimize(ptr);
+    }
+}
@@ -0,0 +1,78 @@
+#include <common/Benchmark.h>
+
+#include <rcpp/rc.h>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+namespace {
+
+constexpr int TreeDepth = 10;
+
+struct TreeNode {
+    TreeNode(int value, Rc<TreeNode> left, Rc<TreeNode> right)
+        : value(value), left(std::move(left)), right(std::move(right))
+    {
+    }
+
+    int value;
+    Rc<TreeNode> left;
+    Rc<TreeNode> right;
+};
+
+Rc<TreeNode> buildTree(int depth)
+{
+    if (depth == 0) {
+        return {};
+    }
+    return make_rc<TreeNode>(depth, buildTree(depth - 1), buildTree(depth - 1));
+}
+
+// Functional-style map over a uniquely owned tree, that allocates a new node for every node.
+Rc<TreeNode> mapMake(Rc<TreeNode> node)
+{
+    if (!node) {
+        return {};
+    }
+    auto left = mapMake(std::move(node->left));
+    auto right = mapMake(std::move(node->right));
+    return make_rc<TreeNode>(node->value + 1, std::move(left), std::move(right));
+}
+
+// The same map, but the memory of the old nodes is reused for the new ones.
+Rc<TreeNode> mapReuse(Rc<TreeNode> node)
+{
+    if (!node) {
+        return {};
+    }
+    auto left = mapReuse(std::move(node->left));
+    auto right = mapReuse(std::move(node->right));
+    const int value = node->value + 1;
+    return Rc<TreeNode>::reuse_or_make(std::move(node), value, std::move(left), std::move(right));
+}
+
+template<typename Map>
+void mapTree(State &state, Map map)
+{
+    auto tree = buildTree(TreeDepth);
+    const auto allocationsAtStart = allocationCount();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        tree = map(std::move(tree));
+        doNotOptimize(tree);
+    }
+    const auto allocations = allocationCount() - allocationsAtStart;
+    state.setCounter("nodes_per_iteration", (1 << TreeDepth) - 1);
+    state.setCounter("allocations_per_iteration", static_cast<double>(allocations) / state.iterations());
+}
+
+} // namespace
+
+RCPP_BENCHMARK(tree_map, make_rc)
+{
+    mapTree(state, mapMake);
+}
+
+RCPP_BENCHMARK(tree_map, reuse_or_make)
+{
+    mapTree(state, mapReuse);
+}
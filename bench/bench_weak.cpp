@@ -0,0 +1,68 @@
+#include <common/Benchmark.h>
+#include <common/Types.h>
+
+#include <rcpp/pweak.h>
+#include <rcpp/weak.h>
+
+#include <memory>
+
+using namespace Rcpp;
+using namespace RcppBench;
+
+RCPP_BENCHMARK(weak_lock, Weak)
+{
+    auto rc = make_rc<Payload>();
+    Weak<Payload> weak(rc);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+RCPP_BENCHMARK(weak_lock, weak_ptr)
+{
+    auto ptr = std::make_shared<Payload>();
+    std::weak_ptr<Payload> weak(ptr);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+RCPP_BENCHMARK(weak_lock_expired, Weak)
+{
+    Weak<Payload> weak(make_rc<Payload>());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+RCPP_BENCHMARK(weak_lock_expired, weak_ptr)
+{
+    std::weak_ptr<Payload> weak(std::make_shared<Payload>());
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+RCPP_BENCHMARK(pweak_lock, Pweak)
+{
+    auto prc = static_pointer_cast<PolymorphicBase>(make_prc<PolymorphicDerived>());
+    Pweak<PolymorphicBase> weak(prc);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
+
+RCPP_BENCHMARK(pweak_lock, weak_ptr)
+{
+    std::shared_ptr<PolymorphicBase> ptr = std::make_shared<PolymorphicDerived>();
+    std::weak_ptr<PolymorphicBase> weak(ptr);
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto locked = weak.lock();
+        doNotOptimize(locked);
+    }
+}
@@ -0,0 +1,304 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+namespace RcppBench {
+
+namespace {
+
+struct BenchmarkEntry {
+    std::string group;
+    std::string variant;
+    BenchmarkFunction function;
+};
+
+std::vector<BenchmarkEntry> &registry()
+{
+    static std::vector<BenchmarkEntry> benchmarks;
+    return benchmarks;
+}
+
+struct Result {
+    std::string group;
+    std::string variant;
+    std::size_t iterations;
+    std::vector<double> nsPerIteration;
+    std::map<std::string, double> counters;
+};
+
+struct Options {
+    std::string filter;
+    std::string output;
+    double minTime = 0.1;
+    std::size_t repetitions = 5;
+    bool list = false;
+};
+
+std::string escape(const std::string &text)
+{
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+thread_local std::size_t allocations = 0;
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    if (values.size() % 2 == 0) {
+        return (values[middle - 1] + values[middle]) / 2;
+    }
+    return values[middle];
+}
+
+} // namespace
+
+std::size_t allocationCount() noexcept
+{
+    return allocations;
+}
+
+State::State(std::size_t iterations)
+    : m_iterations(iterations)
+{
+}
+
+void State::startTiming()
+{
+    m_manualTiming = true;
+    m_start = Clock::now();
+}
+
+void State::stopTiming()
+{
+    m_elapsed += Clock::now() - m_start;
+}
+
+void State::setCounter(const std::string &name, double value)
+{
+    m_counters[name] = value;
+}
+
+Registration::Registration(const char *group, const char *variant, BenchmarkFunction function)
+{
+    registry().push_back({ group, variant, function });
+}
+
+class Runner
+{
+public:
+    explicit Runner(Options options)
+        : m_options(std::move(options))
+    {
+    }
+
+    int run()
+    {
+        std::vector<Result> results;
+        for (const auto &benchmark : registry()) {
+            const auto name = benchmark.group + "/" + benchmark.variant;
+            if (name.find(m_options.filter) == std::string::npos) {
+                continue;
+            }
+            if (m_options.list) {
+                std::cout << name << '\n';
+                continue;
+            }
+            std::cerr << "Running " << name << "..." << std::endl;
+            results.push_back(measure(benchmark));
+        }
+
+        if (m_options.list) {
+            return EXIT_SUCCESS;
+        }
+
+        if (m_options.output.empty()) {
+            writeJson(std::cout, results);
+        } else {
+            std::ofstream file(m_options.output);
+            if (!file) {
+                std::cerr << "Could not open " << m_options.output << " for writing" << std::endl;
+                return EXIT_FAILURE;
+            }
+            writeJson(file, results);
+        }
+        return EXIT_SUCCESS;
+    }
+
+private:
+    static double runOnce(const BenchmarkEntry &benchmark, std::size_t iterations, std::map<std::string, double> *counters = nullptr)
+    {
+        State state(iterations);
+        const auto start = State::Clock::now();
+        benchmark.function(state);
+        const auto end = State::Clock::now();
+
+        if (counters) {
+            *counters = state.m_counters;
+        }
+        const auto elapsed = state.m_manualTiming ? state.m_elapsed : end - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count();
+    }
+
+    Result measure(const BenchmarkEntry &benchmark) const
+    {
+        // Grow the iteration count until a single run takes at least the minimum time.
+        const double minTimeNs = m_options.minTime * 1e9;
+        std::size_t iterations = 1;
+        double elapsed = runOnce(benchmark, iterations);
+        while (elapsed < minTimeNs && iterations < (std::size_t(1) << 40)) {
+            const double factor = elapsed > 0 ? std::min(10.0, std::max(2.0, 1.4 * minTimeNs / elapsed)) : 10.0;
+            iterations = static_cast<std::size_t>(iterations * factor);
+            elapsed = runOnce(benchmark, iterations);
+        }
+
+        Result result{ benchmark.group, benchmark.variant, iterations, {}, {} };
+        for (std::size_t repetition = 0; repetition < m_options.repetitions; ++repetition) {
+            result.nsPerIteration.push_back(runOnce(benchmark, iterations, &result.counters) / iterations);
+        }
+        return result;
+    }
+
+    static void writeJson(std::ostream &out, const std::vector<Result> &results)
+    {
+        const auto now = std::time(nullptr);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+#if defined(__clang__)
+        out << "    \"compiler\": \"clang " << __clang_major__ << "." << __clang_minor__ << "\",\n";
+#elif defined(__GNUC__)
+        out << "    \"compiler\": \"gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "\",\n";
+#elif defined(_MSC_VER)
+        out << "    \"compiler\": \"msvc " << _MSC_VER << "\",\n";
+#endif
+#ifdef NDEBUG
+        out << "    \"assertions\": false\n";
+#else
+        out << "    \"assertions\": true\n";
+#endif
+        out << "  },\n";
+        out << "  \"benchmarks\": [";
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto &result = results[i];
+            const auto [min, max] = std::minmax_element(result.nsPerIteration.begin(), result.nsPerIteration.end());
+
+            std::ostringstream entry;
+            entry.precision(4);
+            entry << std::fixed;
+            entry << (i == 0 ? "\n" : ",\n");
+            entry << "    {\n";
+            entry << "      \"name\": \"" << escape(result.group + "/" + result.variant) << "\",\n";
+            entry << "      \"group\": \"" << escape(result.group) << "\",\n";
+            entry << "      \"variant\": \"" << escape(result.variant) << "\",\n";
+            entry << "      \"iterations\": " << result.iterations << ",\n";
+            entry << "      \"repetitions\": " << result.nsPerIteration.size() << ",\n";
+            entry << "      \"ns_per_iteration\": " << median(result.nsPerIteration) << ",\n";
+            entry << "      \"ns_per_iteration_min\": " << *min << ",\n";
+            entry << "      \"ns_per_iteration_max\": " << *max;
+            if (!result.counters.empty()) {
+                entry << ",\n      \"counters\": {";
+                bool first = true;
+                for (const auto &[name, value] : result.counters) {
+                    entry << (first ? "\n" : ",\n");
+                    entry << "        \"" << escape(name) << "\": " << value;
+                    first = false;
+                }
+                entry << "\n      }";
+            }
+            entry << "\n    }";
+            out << entry.str();
+        }
+        out << "\n  ]\n";
+        out << "}\n";
+    }
+
+    Options m_options;
+};
+
+} // namespace RcppBench
+
+// Counts the allocations for allocationCount, see
+// https://en.cppreference.com/w/cpp/memory/new/operator_new
+void *operator new(std::size_t size)
+{
+    if (size == 0) {
+        ++size; // avoid std::malloc(0) which may return nullptr on success
+    }
+    if (void *pointer = std::malloc(size)) {
+        ++RcppBench::allocations;
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace {
+
+void printUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<n>] [--out=<file>] [--list]\n";
+}
+
+bool startsWith(const char *argument, const char *prefix, const char **value)
+{
+    const auto length = std::strlen(prefix);
+    if (std::strncmp(argument, prefix, length) == 0) {
+        *value = argument + length;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    RcppBench::Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char *value = nullptr;
+        if (startsWith(argv[i], "--filter=", &value)) {
+            options.filter = value;
+        } else if (startsWith(argv[i], "--min-time=", &value)) {
+            options.minTime = std::atof(value);
+        } else if (startsWith(argv[i], "--repetitions=", &value)) {
+            options.repetitions = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (startsWith(argv[i], "--out=", &value)) {
+            options.output = value;
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            options.list = true;
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return RcppBench::Runner(std::move(options)).run();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// A tiny, dependency free micro benchmark harness.
+//
+// Every benchmark belongs to a group (the operation that is measured, e.g. "copy")
+// and has a variant (the implementation that performs it, e.g. "Rc" or "shared_ptr").
+// Variants of the same group are meant to be compared with each other.
+// The runner writes the results as JSON, so they can be tracked over time.
+namespace RcppBench {
+
+class State
+{
+public:
+    explicit State(std::size_t iterations);
+
+    std::size_t iterations() const noexcept
+    {
+        return m_iterations;
+    }
+
+    // By default the whole benchmark function is measured.
+    // Benchmarks with an expensive setup or teardown can restrict
+    // the measurement to the code between these two calls.
+    void startTiming();
+    void stopTiming();
+
+    // Additional values reported next to the timing, e.g. memory usage or latency percentiles.
+    void setCounter(const std::string &name, double value);
+
+private:
+    friend class Runner;
+
+    using Clock = std::chrono::steady_clock;
+
+    std::size_t m_iterations;
+    bool m_manualTiming = false;
+    Clock::time_point m_start;
+    Clock::duration m_elapsed = Clock::duration::zero();
+    std::map<std::string, double> m_counters;
+};
+
+using BenchmarkFunction = void (*)(State &);
+
+// The number of allocations made with operator new on the current thread so far.
+// The benchmark binary replaces operator new to count them, which costs a thread local increment.
+// Aligned operator new is not counted.
+std::size_t allocationCount() noexcept;
+
+struct Registration {
+    Registration(const char *group, const char *variant, BenchmarkFunction function);
+};
+
+// Prevents the compiler from optimizing away the computation of value.
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile(""
+                 :
+                 : "r,m"(value)
+                 : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// Forces all pending writes to memory to be considered observable.
+inline void clobberMemory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile(""
+                 :
+                 :
+                 : "memory");
+#endif
+}
+
+// Measures only the destruction of pointers created by factory.
+// The pointers are created untimed in batches, so allocation cost does not skew the result.
+template<typename Pointer, typename Factory>
+void measureDestruction(State &state, Factory factory)
+{
+    constexpr std::size_t BatchSize = 1024;
+
+    std::vector<Pointer> pointers(BatchSize);
+    for (std::size_t done = 0; done < state.iterations(); done += BatchSize) {
+        const auto count = std::min(BatchSize, state.iterations() - done);
+        for (std::size_t i = 0; i < count; ++i) {
+            pointers[i] = factory();
+        }
+        state.startTiming();
+        for (std::size_t i = 0; i < count; ++i) {
+            pointers[i].reset();
+        }
+        state.stopTiming();
+    }
+}
+
+} // namespace RcppBench
+
+#define RCPP_BENCH_CONCAT_IMPL(a, b) a##b
+#define RCPP_BENCH_CONCAT(a, b) RCPP_BENCH_CONCAT_IMPL(a, b)
+
+// Usage:
+//   RCPP_BENCHMARK(copy, Rc)
+//   {
+//       for (std::size_t i = 0; i < state.iterations(); ++i) { ... }
+//   }
+#define RCPP_BENCHMARK(group, variant)                                                                \
+    static void RCPP_BENCH_CONCAT(bench_##group##_##variant, __LINE__)(RcppBench::State &);           \
+    static const RcppBench::Registration RCPP_BENCH_CONCAT(registration_##group##_##variant, __LINE__)( \
+            #group, #variant, &RCPP_BENCH_CONCAT(bench_##group##_##variant, __LINE__));                \
+    static void RCPP_BENCH_CONCAT(bench_##group##_##variant, __LINE__)(RcppBench::State & state)
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <common/Benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace RcppBench {
+
+// Runs f(iterations) on the given number of threads at the same time and measures until all are done.
+// The iterations of the benchmark are split between the threads.
+template<typename F>
+void runConcurrently(State &state, std::size_t threads, F f)
+{
+    const auto perThread = (state.iterations() + threads - 1) / threads;
+    std::atomic<std::size_t> ready = 0;
+    std::atomic<bool> go = false;
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            ready++;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            f(perThread);
+        });
+    }
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+
+    state.startTiming();
+    go.store(true, std::memory_order_release);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    state.stopTiming();
+    state.setCounter("threads", static_cast<double>(threads));
+}
+
+} // namespace RcppBench
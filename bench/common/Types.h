@@ -0,0 +1,65 @@
+#pragma once
+
+#include <rcpp/intrusive_rc.h>
+
+// Payload types shared by the benchmarks.
+namespace RcppBench {
+
+struct Payload {
+    Payload() = default;
+    explicit Payload(int initial)
+        : value(initial)
+    {
+    }
+
+    int value = 0;
+};
+
+class PolymorphicBase
+{
+public:
+    virtual ~PolymorphicBase() = default;
+
+    virtual int value() const
+    {
+        return 0;
+    }
+};
+
+class PolymorphicDerived : public PolymorphicBase
+{
+public:
+    int value() const override
+    {
+        return m_value;
+    }
+
+private:
+    int m_value = 1;
+};
+
+// The same hierarchy with an intrusive reference count.
+class IntrusiveBase : public Rcpp::IntrusiveRcBase<IntrusiveBase>
+{
+public:
+    virtual ~IntrusiveBase() = default;
+
+    virtual int value() const
+    {
+        return 0;
+    }
+};
+
+class IntrusiveDerived : public IntrusiveBase
+{
+public:
+    int value() const override
+    {
+        return m_value;
+    }
+
+private:
+    int m_value = 1;
+};
+
+} // namespace RcppBench
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Rcpp {
+
+namespace {
+
+// What releasing a strong reference of an Arc requires.
+enum class ArcRelease {
+    // other strong references remain
+    Kept,
+    // the value must be destructed, then the implicit weak reference released
+    LastStrong,
+    // the value must be destructed and the block freed, there are no weak references
+    LastReference,
+};
+
+// The reference counts of a value managed by Arc/Parc, like RcControlBlock but with atomic counts.
+//
+// Both counts are packed into a single word (the strong count in the upper half), so every operation
+// is a single atomic read-modify-write and sees a consistent snapshot of both counts: Upgrading a
+// weak reference, which must not revive a value whose strong count already reached zero, is one
+// compare-and-swap. Releasing the last strong reference also tells whether weak references exist;
+// if not, the block is freed without releasing the implicit weak reference first. A block that is
+// uniquely referenced is even freed after a single load.
+//
+// Increments only need to be atomic, they are relaxed: a new reference is always created from an
+// existing one, which keeps the value alive. Decrements release the changes made through the
+// reference, and the thread that drops the last one acquires them before destroying the value.
+template<typename Counter>
+class ArcControlBlock
+{
+    static_assert(std::is_unsigned_v<Counter>, "The counter of an Arc must be an unsigned integer type");
+    static_assert(sizeof(Counter) <= sizeof(std::uint32_t), "Arc packs both counts into one word, the counter can have at most 32 bits");
+
+    using Word = std::conditional_t<sizeof(Counter) == 1, std::uint16_t, std::conditional_t<sizeof(Counter) == 2, std::uint32_t, std::uint64_t>>;
+
+    static constexpr int CounterBits = std::numeric_limits<Counter>::digits;
+    static constexpr Word WeakOne = 1;
+    static constexpr Word StrongOne = Word(1) << CounterBits;
+
+    // a new block starts with its first strong reference and the implicit weak reference
+    std::atomic<Word> m_counts = StrongOne + WeakOne;
+
+    static Counter strongOf(Word counts) noexcept
+    {
+        return static_cast<Counter>(counts >> CounterBits);
+    }
+
+    static Counter weakOf(Word counts) noexcept
+    {
+        return static_cast<Counter>(counts);
+    }
+
+public:
+    void incrementStrong() noexcept
+    {
+        [[maybe_unused]] const auto previous = m_counts.fetch_add(StrongOne, std::memory_order_relaxed);
+        assert(strongOf(previous) != std::numeric_limits<Counter>::max() && "Too many strong references for the Arc counter type");
+    }
+
+    // Adds several strong references at once, for AtomicArc.
+    void incrementStrong(Counter count) noexcept
+    {
+        [[maybe_unused]] const auto previous = m_counts.fetch_add(Word(count) * StrongOne, std::memory_order_relaxed);
+        assert(strongOf(previous) <= std::numeric_limits<Counter>::max() - count && "Too many strong references for the Arc counter type");
+    }
+
+    // Releases several strong references at once, for AtomicArc. The caller must keep at least one more.
+    void decrementStrong(Counter count) noexcept
+    {
+        [[maybe_unused]] const auto previous = m_counts.fetch_sub(Word(count) * StrongOne, std::memory_order_release);
+        assert(strongOf(previous) > count && "decrementStrong must not release the last strong reference");
+    }
+
+    void incrementWeak() noexcept
+    {
+        [[maybe_unused]] const auto previous = m_counts.fetch_add(WeakOne, std::memory_order_relaxed);
+        assert(weakOf(previous) != std::numeric_limits<Counter>::max() && "Too many weak references for the Arc counter type");
+    }
+
+    // Increments the strong count unless it is zero, returns whether it was incremented.
+    bool tryIncrementStrong() noexcept
+    {
+        auto counts = m_counts.load(std::memory_order_relaxed);
+        while (strongOf(counts) != 0) {
+            if (m_counts.compare_exchange_weak(counts, counts + StrongOne, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ArcRelease releaseStrong() noexcept
+    {
+        if (isUnique()) {
+            // nobody else can access the block, so it needs no read-modify-write at all
+            return ArcRelease::LastReference;
+        }
+        return releaseShared();
+    }
+
+    // Like releaseStrong, but always uses a read-modify-write, for blocks that other threads may
+    // still upgrade with tryIncrementStrong without holding a reference (see EpochArc).
+    ArcRelease releaseShared() noexcept
+    {
+        const auto previous = m_counts.fetch_sub(StrongOne, std::memory_order_release);
+        if (strongOf(previous) != 1) {
+            return ArcRelease::Kept;
+        }
+        acquire();
+        // Weak references can only be created from other references, so if only the implicit one
+        // exists, nobody else can access the block anymore.
+        return weakOf(previous) == 1 ? ArcRelease::LastReference : ArcRelease::LastStrong;
+    }
+
+    // Returns the remaining number of weak references.
+    Counter decrementWeak() noexcept
+    {
+        const auto remaining = weakOf(m_counts.fetch_sub(WeakOne, std::memory_order_release)) - 1;
+        if (remaining == 0) {
+            acquire();
+        }
+        return remaining;
+    }
+
+    // Only snapshots, other threads may change the counts at any time.
+    Counter strong() const noexcept
+    {
+        return strongOf(m_counts.load(std::memory_order_acquire));
+    }
+
+    Counter weak() const noexcept
+    {
+        return weakOf(m_counts.load(std::memory_order_acquire));
+    }
+
+    // Whether the caller holds the only strong reference and no weak references exist.
+    // As no other thread can create new references then, the answer is stable.
+    bool isUnique() const noexcept
+    {
+        return m_counts.load(std::memory_order_acquire) == StrongOne + WeakOne;
+    }
+
+    void deallocate() noexcept
+    {
+        ::operator delete(static_cast<void *>(this));
+    }
+
+private:
+    // Synchronizes with the releases of all other references before the value is destroyed.
+    // An acquire load instead of a fence, as ThreadSanitizer does not understand fences.
+    void acquire() const noexcept
+    {
+        m_counts.load(std::memory_order_acquire);
+    }
+};
+
+template<typename T, typename Counter>
+class ArcValue : public ArcControlBlock<Counter>
+{
+public:
+    template<typename... Args>
+    ArcValue(Args &&...args)
+        : ArcControlBlock<Counter>(), m_content(std::forward<Args>(args)...)
+    {
+    }
+
+    ~ArcValue() { }
+
+    T &content() noexcept
+    {
+        return m_content;
+    }
+
+    void destructContent()
+    {
+        m_content.~T();
+    }
+
+private:
+    // destructed by destructContent with the last strong reference
+    union {
+        T m_content;
+    };
+};
+
+} // namespace
+
+// forward declarations necessary for friend declarations
+template<typename T, typename Counter = std::uint32_t>
+class Parc;
+
+template<typename T, typename Counter = std::uint32_t>
+class AWeak;
+
+template<typename T, typename Counter = std::uint32_t>
+class AtomicArc;
+
+// The thread-safe counterpart of Rc.
+//
+// Arc has the same single-pointer layout and API as Rc, but its reference counts are atomic,
+// so copies of it can be used and released on any thread. The value itself is not synchronized,
+// share only values that are immutable or synchronize themselves.
+// Copying and releasing an Arc is noticeably slower than an Rc, prefer Rc for values that stay on one thread.
+template<typename T, typename Counter = std::uint32_t>
+class Arc
+{
+public:
+    template<typename U, typename C>
+    friend class AWeak;
+
+    template<typename U, typename C>
+    friend class Parc;
+
+    template<typename U, typename C>
+    friend class AtomicArc;
+
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, C>> dynamic_base_pointer_cast(const Parc<Base, C> &);
+
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, C>> dynamic_base_pointer_cast(Parc<Base, C> &&);
+
+    template<typename U, typename C>
+    friend U *get_mut(Arc<U, C> &) noexcept;
+
+    Arc()
+        : m_value(nullptr)
+    {
+    }
+
+    Arc(const Arc &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    Arc(Arc &&other) noexcept
+        : Arc()
+    {
+        swap(*this, other);
+    }
+
+    ~Arc()
+    {
+        reset();
+    }
+
+    friend void swap(Arc &first, Arc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    Arc &operator=(Arc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    // Creates a new value, see make_arc.
+    // Use this instead of make_arc to create an Arc with a different Counter type.
+    template<typename... Args>
+    static Arc make(Args &&...args)
+    {
+        // Parc frees the block without knowing its alignment
+        static_assert(alignof(ArcValue<T, Counter>) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Arc does not support over-aligned types");
+        // the block already counts the first reference and one implicit weak reference for all
+        // strong references, like Rc, so creating it needs no atomic operations
+        return adopt(*new ArcValue<T, Counter>(std::forward<Args>(args)...));
+    }
+
+    void reset()
+    {
+        if (m_value) {
+            const auto release = m_value->releaseStrong();
+            if (release != ArcRelease::Kept) {
+                m_value->destructContent();
+                // the implicit weak reference of the strong references
+                if (release == ArcRelease::LastReference || m_value->decrementWeak() == 0) {
+                    m_value->deallocate();
+                }
+            }
+        }
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return m_value->content();
+    }
+
+    T *operator->() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    ArcValue<T, Counter> *m_value;
+
+    Arc(ArcValue<T, Counter> &value)
+        : m_value(&value)
+    {
+        m_value->incrementStrong();
+    }
+
+    // Takes over a strong reference that was already counted.
+    static Arc adopt(ArcValue<T, Counter> &value) noexcept
+    {
+        Arc arc;
+        arc.m_value = &value;
+        return arc;
+    }
+};
+
+// Like get_mut for Rc: returns a pointer to the value if no other Arc or AWeak refers to it.
+template<typename T, typename Counter>
+T *get_mut(Arc<T, Counter> &arc) noexcept
+{
+    if (arc && arc.m_value->isUnique()) {
+        return &arc.m_value->content();
+    }
+    return nullptr;
+}
+
+// Creates a new value that is managed by an Arc, like make_rc.
+template<typename T, typename... Args>
+Arc<T> make_arc(Args &&...args)
+{
+    return Arc<T>::make(std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <rcpp/arc.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+
+namespace Rcpp {
+
+// A cell that holds an Arc and can be loaded, stored and exchanged from any thread at the same time,
+// like std::atomic<std::shared_ptr<T>>, e.g. to publish immutable snapshots to many readers.
+//
+// It uses split reference counting: the cell packs its Arc's pointer and a local count
+// into one 64-bit word. Storing an Arc charges it with Reserve strong references at once, which the
+// cell hands out to readers: load() increments the local count with a single compare-and-swap on the
+// word and the reader owns one of the charged references, without touching the value. Whoever takes
+// the value out of the cell again releases the references that no reader took.
+// Once half of the reserve is used up, a reader recharges it. As the local count only ever describes
+// the pointer stored next to it, a value that is stored again (ABA) is accounted correctly.
+//
+// store(), exchange() and compare_exchange are lock-free. load() is not strictly: a reader can only
+// take a reference while the reserve is not exhausted. That happens if Reserve / 2 other readers took
+// a reference but did not finish their recharge yet, e.g. because they were preempted, and the reader
+// then waits until one of them recharges the cell. It can not recharge the cell itself, as
+// it holds no reference that keeps the value alive, so is_lock_free() returns false.
+//
+// Requires 64-bit pointers with at most 48 significant bits (x86-64, AArch64) and an Arc counter of
+// at least 32 bits.
+template<typename T, typename Counter>
+class AtomicArc
+{
+    static_assert(sizeof(void *) == sizeof(std::uint64_t), "AtomicArc requires 64-bit pointers");
+    static_assert(std::numeric_limits<Counter>::digits >= 32, "AtomicArc charges many references at once, the Arc counter needs at least 32 bits");
+
+    using Word = std::uint64_t;
+
+    static constexpr int PointerBits = 48;
+    static constexpr Word PointerMask = (Word(1) << PointerBits) - 1;
+    static constexpr Word LocalOne = Word(1) << PointerBits;
+    // the strong references a stored Arc is charged with, the local count can never exceed it
+    static constexpr Counter Reserve = std::numeric_limits<std::uint16_t>::max();
+
+public:
+    AtomicArc() noexcept
+        : m_word(0)
+    {
+    }
+
+    explicit AtomicArc(Arc<T, Counter> arc) noexcept
+        : m_word(charge(std::move(arc)))
+    {
+    }
+
+    AtomicArc(const AtomicArc &) = delete;
+    AtomicArc &operator=(const AtomicArc &) = delete;
+
+    ~AtomicArc()
+    {
+        takeOver(m_word.load(std::memory_order_relaxed));
+    }
+
+    // load() may wait for other readers, see above
+    static constexpr bool is_lock_free() noexcept
+    {
+        return false;
+    }
+
+    Arc<T, Counter> load() const noexcept
+    {
+        auto word = m_word.load(std::memory_order_relaxed);
+        while (true) {
+            auto *value = pointerOf(word);
+            if (!value) {
+                return {};
+            }
+            const auto taken = localOf(word);
+            if (taken == Reserve - 1) {
+                // The reserve is exhausted, the cell keeps its last reference. At least Reserve / 2
+                // readers took a reference since the last recharge and each of them recharges it.
+                std::this_thread::yield();
+                word = m_word.load(std::memory_order_relaxed);
+            } else if (m_word.compare_exchange_weak(word, word + LocalOne, std::memory_order_acquire, std::memory_order_relaxed)) {
+                auto arc = Arc<T, Counter>::adopt(*value);
+                if (taken + 1 >= Reserve / 2) {
+                    recharge(*value);
+                }
+                return arc;
+            }
+        }
+    }
+
+    void store(Arc<T, Counter> desired) noexcept
+    {
+        exchange(std::move(desired));
+    }
+
+    Arc<T, Counter> exchange(Arc<T, Counter> desired) noexcept
+    {
+        return takeOver(m_word.exchange(charge(std::move(desired)), std::memory_order_acq_rel));
+    }
+
+    // Stores desired if the cell holds the same value as expected, otherwise loads the current value into expected.
+    bool compare_exchange_strong(Arc<T, Counter> &expected, Arc<T, Counter> desired) noexcept
+    {
+        const auto desiredWord = charge(std::move(desired));
+
+        auto word = m_word.load(std::memory_order_relaxed);
+        while (pointerOf(word) == expected.m_value) {
+            if (m_word.compare_exchange_weak(word, desiredWord, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                takeOver(word);
+                return true;
+            }
+        }
+
+        // undo the charge, desired was not stored
+        takeOver(desiredWord);
+        expected = load();
+        return false;
+    }
+
+    bool compare_exchange_weak(Arc<T, Counter> &expected, Arc<T, Counter> desired) noexcept
+    {
+        return compare_exchange_strong(expected, std::move(desired));
+    }
+
+private:
+    // mutable, as load() needs to count the reader
+    mutable std::atomic<Word> m_word;
+
+    static ArcValue<T, Counter> *pointerOf(Word word) noexcept
+    {
+        return reinterpret_cast<ArcValue<T, Counter> *>(static_cast<std::uintptr_t>(word & PointerMask));
+    }
+
+    static Counter localOf(Word word) noexcept
+    {
+        return static_cast<Counter>(word >> PointerBits);
+    }
+
+    // Turns the reference of the Arc into the charged references of a cell word.
+    static Word charge(Arc<T, Counter> &&arc) noexcept
+    {
+        auto *value = std::exchange(arc.m_value, nullptr);
+        if (!value) {
+            return 0;
+        }
+        const auto address = static_cast<Word>(reinterpret_cast<std::uintptr_t>(value));
+        assert((address & ~PointerMask) == 0 && "AtomicArc requires pointers with at most 48 significant bits");
+        value->incrementStrong(Reserve - 1);
+        return address;
+    }
+
+    // Turns the references of a word that was taken out of the cell into a single Arc again.
+    static Arc<T, Counter> takeOver(Word word) noexcept
+    {
+        auto *value = pointerOf(word);
+        if (!value) {
+            return {};
+        }
+        const auto unused = Reserve - localOf(word) - 1;
+        if (unused != 0) {
+            value->decrementStrong(unused);
+        }
+        return Arc<T, Counter>::adopt(*value);
+    }
+
+    // Charges the references that readers took from the cell again, if it still holds value.
+    // The caller holds a reference to value, so it stays alive.
+    void recharge(ArcValue<T, Counter> &value) const noexcept
+    {
+        auto word = m_word.load(std::memory_order_relaxed);
+        while (pointerOf(word) == &value && localOf(word) >= Reserve / 2) {
+            const auto taken = localOf(word);
+            // charge first, readers must never take a reference that is not counted yet, the release
+            // makes sure they acquire the charge before releasing their reference
+            value.incrementStrong(taken);
+            if (m_word.compare_exchange_weak(word, word - taken * LocalOne, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+            value.decrementStrong(taken);
+        }
+    }
+};
+
+} // namespace Rcpp
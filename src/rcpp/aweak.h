@@ -0,0 +1,90 @@
+#pragma once
+
+#include <rcpp/arc.h>
+
+#include <utility>
+
+namespace Rcpp {
+
+// The thread-safe counterpart of Weak, a weak reference to the value of an Arc.
+template<typename T, typename Counter>
+class AWeak
+{
+public:
+    AWeak(const Arc<T, Counter> &strong)
+        : m_value(strong.m_value)
+    {
+        if (m_value) {
+            m_value->incrementWeak();
+        }
+    }
+
+    AWeak(const AWeak &other)
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementWeak();
+        }
+    }
+
+    AWeak(AWeak &&other)
+        : AWeak()
+    {
+        swap(*this, other);
+    }
+
+    AWeak()
+        : m_value(nullptr) { }
+
+    friend void swap(AWeak &first, AWeak &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    AWeak &operator=(AWeak other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    AWeak &operator=(const Arc<T, Counter> &strong)
+    {
+        reset();
+        m_value = strong.m_value;
+        if (m_value) {
+            m_value->incrementWeak();
+        }
+        return *this;
+    }
+
+    ~AWeak()
+    {
+        reset();
+    }
+
+    // Another thread may release the last strong reference at any time,
+    // so the strong count is only incremented if it is not zero yet.
+    Arc<T, Counter> lock() const noexcept
+    {
+        if (m_value && m_value->tryIncrementStrong()) {
+            return Arc<T, Counter>::adopt(*m_value);
+        }
+        return Arc<T, Counter>();
+    }
+
+    void reset()
+    {
+        if (m_value && m_value->decrementWeak() == 0) {
+            m_value->deallocate();
+        }
+
+        m_value = nullptr;
+    }
+
+private:
+    ArcValue<T, Counter> *m_value;
+};
+
+} // namespace Rcpp
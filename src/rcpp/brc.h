@@ -0,0 +1,382 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Rcpp {
+
+// The per-thread state of biased reference counting, see Brc.
+//
+// Every thread that creates a Brc owns a BrcThread. Other threads hand the references they release
+// to the queue of the owner, which merges the counts of the queued values. The BrcThread stays
+// alive after its thread exited until the last value it owns is destroyed.
+//
+// Once the thread-local objects of a thread are destroyed, it has no BrcThread anymore: values it
+// creates from then on, e.g. in the destructor of a static object, have no owner and are shared from
+// the start.
+class BrcThread
+{
+public:
+    struct Entry {
+        void *value;
+        void (*merge)(void *value) noexcept;
+    };
+
+    BrcThread(const BrcThread &) = delete;
+    BrcThread &operator=(const BrcThread &) = delete;
+
+    // The BrcThread of the current thread, nullptr if it did not create a Brc yet.
+    static BrcThread *current() noexcept
+    {
+        return s_current;
+    }
+
+    // Like current, but creates the BrcThread if necessary.
+    // Returns nullptr once the thread-local objects of the thread are destroyed.
+    static BrcThread *currentOrCreate()
+    {
+        if (!s_current && !s_exited) {
+            static thread_local Holder holder;
+        }
+        return s_current;
+    }
+
+    // Called by the owner for every value it creates.
+    void created() noexcept
+    {
+        m_owned++;
+    }
+
+    // Called for every value this thread owned when it is destroyed, on any thread.
+    void destroyed() noexcept
+    {
+        if (this == s_current) {
+            m_owned--;
+        } else if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // the thread exited and this was its last value
+            delete this;
+        }
+    }
+
+    // Queues a value for its owner. Returns false if the owning thread already exited,
+    // in which case the caller has to merge the value itself.
+    bool enqueue(Entry entry) noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_exited) {
+            return false;
+        }
+        m_queue.push_back(entry);
+        m_pending.store(true, std::memory_order_release);
+        return true;
+    }
+
+    bool hasPending() const noexcept
+    {
+        return m_pending.load(std::memory_order_relaxed);
+    }
+
+    // Merges the values queued by other threads, must be called on the owning thread.
+    std::size_t merge() noexcept
+    {
+        assert(this == s_current && "Only the owning thread can merge its queue");
+        std::vector<Entry> queue;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            queue.swap(m_queue);
+            m_pending.store(false, std::memory_order_relaxed);
+        }
+        for (const auto &entry : queue) {
+            entry.merge(entry.value);
+        }
+        return queue.size();
+    }
+
+private:
+    // creates the BrcThread of a thread and releases it when the thread exits
+    struct Holder {
+        Holder()
+        {
+            s_current = new BrcThread();
+        }
+
+        ~Holder()
+        {
+            auto *thread = s_current;
+            std::unique_lock<std::mutex> lock(thread->m_mutex);
+            // values released by the merged values may queue further values
+            while (!thread->m_queue.empty()) {
+                auto queue = std::move(thread->m_queue);
+                thread->m_queue.clear();
+                lock.unlock();
+                for (const auto &entry : queue) {
+                    entry.merge(entry.value);
+                }
+                lock.lock();
+            }
+            thread->m_exited = true;
+            lock.unlock();
+
+            s_current = nullptr;
+            s_exited = true;
+            // the values that are still alive, minus those that other threads destroyed meanwhile
+            const auto owned = static_cast<std::ptrdiff_t>(thread->m_owned);
+            if (thread->m_remaining.fetch_add(owned, std::memory_order_acq_rel) + owned == 0) {
+                delete thread;
+            }
+        }
+    };
+
+    BrcThread() = default;
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_queue;
+    bool m_exited = false;
+    std::atomic<bool> m_pending = false;
+    // The values created minus the values destroyed by the owner, only used by the owner.
+    std::size_t m_owned = 0;
+    // Minus the values of this thread destroyed by other threads. When the thread exits, the owned
+    // values are added, then the last value of the thread to be destroyed frees the BrcThread.
+    std::atomic<std::ptrdiff_t> m_remaining = 0;
+
+    // trivially destructible, so they can still be used while the thread-local objects are destroyed
+    static inline thread_local BrcThread *s_current = nullptr;
+    static inline thread_local bool s_exited = false;
+};
+
+namespace {
+
+// The control block and value of a Brc.
+//
+// The owning thread counts its references in m_biased without atomic operations. All other threads
+// count theirs in m_shared, which can become negative when they release references that were counted
+// by the owner. Its two lowest bits are flags: Merged is set once m_shared holds the whole count
+// (then m_biased is zero and all threads use m_shared), Queued once the value was handed to the owner.
+// Values without an owner are merged from the start.
+template<typename T, typename Counter>
+class BrcValue
+{
+    static_assert(std::is_unsigned_v<Counter>, "The counter of a Brc must be an unsigned integer type");
+
+    using Shared = std::make_signed_t<Counter>;
+
+    static constexpr Shared Merged = 1;
+    static constexpr Shared Queued = 2;
+    static constexpr Shared Flags = Merged | Queued;
+    static constexpr Shared One = 4;
+
+public:
+    template<typename... Args>
+    BrcValue(BrcThread *owner, Args &&...args)
+        : m_owner(owner), m_biased(owner ? 1 : 0), m_shared(owner ? 0 : One | Merged), m_content(std::forward<Args>(args)...)
+    {
+        if (owner) {
+            owner->created();
+        }
+    }
+
+    static void destroy(BrcValue *value) noexcept
+    {
+        // the destructor of the content may destroy further values of the owner, so the owner is
+        // only told afterwards, as it may free itself
+        auto *owner = value->m_owner;
+        delete value;
+        if (owner) {
+            owner->destroyed();
+        }
+    }
+
+    void increment() noexcept
+    {
+        if (isBiased()) {
+            assert(m_biased != std::numeric_limits<Counter>::max() && "Too many references for the Brc counter type");
+            ++m_biased;
+        } else {
+            m_shared.fetch_add(One, std::memory_order_relaxed);
+        }
+    }
+
+    // Releases a reference, returns whether it was the last one.
+    bool decrement() noexcept
+    {
+        if (!isBiased()) {
+            return releaseShared();
+        }
+        if (--m_biased > 0) {
+            return false;
+        }
+        // the owner gives up its bias, from now on all threads use the shared count
+        const auto old = m_shared.fetch_add(Merged, std::memory_order_acq_rel);
+        return count(old) == 0;
+    }
+
+    T &content() noexcept
+    {
+        return m_content;
+    }
+
+private:
+    bool isBiased() const noexcept
+    {
+        // m_biased is only read by the owner, it is zero once the counts are merged
+        return m_owner == BrcThread::current() && m_biased > 0;
+    }
+
+    static Shared count(Shared shared) noexcept
+    {
+        return shared & ~Flags;
+    }
+
+    bool releaseShared() noexcept
+    {
+        auto old = m_shared.load(std::memory_order_relaxed);
+        while (true) {
+            if (!(old & Merged) && count(old) <= 0 && !(old & Queued)) {
+                // the reference is counted by the owner, so the owner has to merge the counts
+                // before the value can be destroyed. The queue keeps the reference until then.
+                if (m_shared.compare_exchange_weak(old, old | Queued, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    if (!m_owner->enqueue({ this, &BrcValue::mergeQueued })) {
+                        mergeQueued(this);
+                    }
+                    return false;
+                }
+            } else if (m_shared.compare_exchange_weak(old, old - One, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return (old & Merged) && count(old - One) == 0;
+            }
+        }
+    }
+
+    // Runs on the owner, or on any thread after the owner exited (synchronized by the queue's mutex).
+    static void mergeQueued(void *pointer) noexcept
+    {
+        auto *value = static_cast<BrcValue *>(pointer);
+        if (value->m_biased > 0) {
+            value->m_shared.fetch_add(static_cast<Shared>(value->m_biased) * One + Merged, std::memory_order_acq_rel);
+            value->m_biased = 0;
+        }
+        // the reference of the queue
+        if (value->releaseShared()) {
+            destroy(value);
+        }
+    }
+
+    BrcThread *m_owner;
+    Counter m_biased;
+    std::atomic<Shared> m_shared;
+    T m_content;
+};
+
+} // namespace
+
+// A thread-safe Rc with biased reference counting.
+//
+// Most shared values are only used by the thread that created them. Brc counts the references of
+// this owning thread without atomic operations, so it is almost as cheap as Rc there. Other threads
+// use a separate atomic count. When they release references that were counted by the owner, the
+// value is queued to the owner, which merges both counts once it calls merge_biased_counts()
+// (or creates its next Brc, or exits). Values handed to other threads are therefore only destroyed
+// after their owner merged them.
+//
+// Like RcStrongOnly, Brc does not support weak references. Values are not synchronized.
+template<typename T, typename Counter = std::size_t>
+class Brc
+{
+public:
+    Brc() noexcept
+        : m_value(nullptr)
+    {
+    }
+
+    Brc(const Brc &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->increment();
+        }
+    }
+
+    Brc(Brc &&other) noexcept
+        : Brc()
+    {
+        swap(*this, other);
+    }
+
+    ~Brc()
+    {
+        reset();
+    }
+
+    friend void swap(Brc &first, Brc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    Brc &operator=(Brc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    // Creates a new value owned by the current thread, see make_brc.
+    template<typename... Args>
+    static Brc make(Args &&...args)
+    {
+        auto *thread = BrcThread::currentOrCreate();
+        if (thread && thread->hasPending()) {
+            thread->merge();
+        }
+        Brc brc;
+        brc.m_value = new BrcValue<T, Counter>(thread, std::forward<Args>(args)...);
+        return brc;
+    }
+
+    void reset()
+    {
+        if (m_value && m_value->decrement()) {
+            BrcValue<T, Counter>::destroy(m_value);
+        }
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return m_value->content();
+    }
+
+    T *operator->() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    BrcValue<T, Counter> *m_value;
+};
+
+template<typename T, typename... Args>
+Brc<T> make_brc(Args &&...args)
+{
+    return Brc<T>::make(std::forward<Args>(args)...);
+}
+
+// Merges the counts of the values of the current thread that other threads released references to,
+// and destroys those that are no longer referenced. Returns the number of merged references.
+inline std::size_t merge_biased_counts() noexcept
+{
+    auto *thread = BrcThread::current();
+    return thread ? thread->merge() : 0;
+}
+
+} // namespace Rcpp
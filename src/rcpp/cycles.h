@@ -0,0 +1,307 @@
+#pragma once
+
+#include <rcpp/rc.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Rcpp {
+
+class RcTracer;
+
+// Type-erased access to the control block of a traceable value, used by the cycle collector.
+// The values are passed as pointers to their RcControlBlock.
+struct RcCollectableOps {
+    std::size_t (*strong)(void *value);
+    void (*incrementStrong)(void *value);
+    void (*decrementStrong)(void *value);
+    void (*destructContent)(void *value);
+    void (*releaseWeak)(void *value);
+    void (*clearBuffered)(void *value);
+    void (*trace)(void *value, RcTracer &tracer);
+};
+
+namespace {
+
+template<typename T, typename Counter>
+struct RcCollectable {
+    static RcValue<T, Counter> *cast(void *value) noexcept
+    {
+        return static_cast<RcValue<T, Counter> *>(static_cast<RcControlBlock<Counter> *>(value));
+    }
+
+    static void *erase(RcValue<T, Counter> *value) noexcept
+    {
+        return static_cast<RcControlBlock<Counter> *>(value);
+    }
+
+    static constexpr RcCollectableOps ops = {
+        [](void *value) -> std::size_t { return cast(value)->strong(); },
+        [](void *value) { cast(value)->incrementStrong(); },
+        [](void *value) { cast(value)->decrementStrong(); },
+        [](void *value) { cast(value)->destructContent(); },
+        [](void *value) {
+            if (cast(value)->decrementWeak() == 0) {
+                cast(value)->deallocate();
+            }
+        },
+        [](void *value) { cast(value)->clearBuffered(); },
+        [](void *value, RcTracer &tracer) { cast(value)->content().trace(tracer); },
+    };
+};
+
+} // namespace
+
+// Passed to the trace member function of traceable types, which call it for each of their Rc fields:
+//
+//     void trace(RcTracer &tracer) const
+//     {
+//         tracer(m_next);
+//         for (const auto &child : m_children) {
+//             tracer(child);
+//         }
+//     }
+//
+// Rcs to types that are not traceable are ignored. Such values can still be part of a cycle, but the
+// collector can not see the references they hold: they act like references from outside the graph,
+// so cycles through them are never collected.
+class RcTracer
+{
+public:
+    template<typename T, typename Counter>
+    void operator()(const Rc<T, Counter> &rc)
+    {
+        if constexpr (RcTraceable<T>::value) {
+            if (rc.m_value) {
+                m_visit(m_context, RcCollectable<T, Counter>::erase(rc.m_value), RcCollectable<T, Counter>::ops);
+            }
+        }
+    }
+
+private:
+    friend class RcCycleCollector;
+
+    using Visit = void (*)(void *context, void *value, const RcCollectableOps &ops);
+
+    RcTracer(Visit visit, void *context) noexcept
+        : m_visit(visit), m_context(context)
+    {
+    }
+
+    Visit m_visit;
+    void *m_context;
+};
+
+// A synchronous cycle collector for Rc graphs (Bacon-Rajan trial deletion).
+//
+// When the strong count of a traceable value is decremented to a value other than zero, the value is
+// buffered as a possible root of a garbage cycle. collect() then subtracts the references between the
+// values reachable from these roots. Values whose count drops to zero are only referenced from within
+// garbage cycles and are destructed and freed.
+//
+// Like in Bacon and Rajan's collector, buffered values are flagged in their control block, so each
+// value is buffered at most once. The buffer does not keep them alive, values that are freed in the
+// meantime remove themselves from it (see RcRootBuffer). The state is per thread, so values must be
+// released on the thread that buffered them.
+// Only references held by an Rc<T> are considered, values referenced by a Prc are never collected.
+class RcCycleCollector
+{
+    enum class Color {
+        Black,
+        Gray,
+        White,
+    };
+
+    struct Node {
+        const RcCollectableOps *ops;
+        std::size_t count;
+        Color color;
+    };
+
+    struct Edge {
+        void *value;
+        const RcCollectableOps *ops;
+    };
+
+    using Nodes = std::unordered_map<void *, Node>;
+
+public:
+    template<typename T, typename Counter>
+    static void possibleRoot(RcValue<T, Counter> &value)
+    {
+        // each value is buffered at most once, and references released while destructing garbage do
+        // not create new roots
+        if (value.isBuffered() || s_collecting) {
+            return;
+        }
+        // the buffer is gone once the thread-local objects of the thread are destroyed
+        if (auto *roots = RcRootBuffer::roots()) {
+            roots->emplace(RcCollectable<T, Counter>::erase(&value), &RcCollectable<T, Counter>::ops);
+            value.setBuffered();
+        }
+    }
+
+    // Frees all garbage cycles reachable from the buffered roots.
+    // Returns the number of values that were freed.
+    static std::size_t collect()
+    {
+        auto *buffer = RcRootBuffer::roots();
+        if (s_collecting || !buffer) {
+            return 0;
+        }
+        s_collecting = true;
+
+        // no value is buffered during the collection, so freeing one does not touch the buffer
+        std::vector<Edge> roots;
+        roots.reserve(buffer->size());
+        for (const auto &[value, ops] : *buffer) {
+            ops->clearBuffered(value);
+            // values that are only kept by weak references can not be part of a cycle
+            if (ops->strong(value) != 0) {
+                roots.push_back({ value, ops });
+            }
+        }
+        // swapping out the buffer also frees its memory
+        RcRootBuffer::Roots().swap(*buffer);
+
+        Nodes nodes;
+        std::vector<Edge> stack;
+        for (const auto &root : roots) {
+            markGray(nodes, stack, root);
+        }
+        for (const auto &root : roots) {
+            scan(nodes, stack, root);
+        }
+
+        std::vector<Edge> garbage;
+        for (const auto &[value, node] : nodes) {
+            if (node.color == Color::White) {
+                garbage.push_back({ value, node.ops });
+            }
+        }
+        // keep all garbage alive until every value is destructed, as they still refer to each other
+        for (const auto &value : garbage) {
+            value.ops->incrementStrong(value.value);
+        }
+        for (const auto &value : garbage) {
+            value.ops->destructContent(value.value);
+        }
+        for (const auto &value : garbage) {
+            value.ops->decrementStrong(value.value);
+            // the implicit weak reference of the strong references
+            value.ops->releaseWeak(value.value);
+        }
+
+        s_collecting = false;
+        return garbage.size();
+    }
+
+    // The number of buffered possible roots of the current thread.
+    static std::size_t roots() noexcept
+    {
+        const auto *buffer = RcRootBuffer::roots();
+        return buffer ? buffer->size() : 0;
+    }
+
+private:
+    template<typename F>
+    static void forEachChild(const Edge &value, F &&visit)
+    {
+        RcTracer tracer(
+            [](void *context, void *child, const RcCollectableOps &ops) {
+                (*static_cast<std::remove_reference_t<F> *>(context))(Edge { child, &ops });
+            },
+            &visit);
+        value.ops->trace(value.value, tracer);
+    }
+
+    static Node &node(Nodes &nodes, const Edge &value)
+    {
+        return nodes.try_emplace(value.value, Node { value.ops, value.ops->strong(value.value), Color::Black }).first->second;
+    }
+
+    // Subtracts the references from within the subgraph of root from the counts.
+    static void markGray(Nodes &nodes, std::vector<Edge> &stack, const Edge &root)
+    {
+        auto &rootNode = node(nodes, root);
+        if (rootNode.color == Color::Gray) {
+            return;
+        }
+        rootNode.color = Color::Gray;
+
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const auto value = stack.back();
+            stack.pop_back();
+            forEachChild(value, [&](const Edge &child) {
+                auto &childNode = node(nodes, child);
+                childNode.count--;
+                if (childNode.color != Color::Gray) {
+                    childNode.color = Color::Gray;
+                    stack.push_back(child);
+                }
+            });
+        }
+    }
+
+    // Marks the values that are only referenced from within the subgraph as garbage (white),
+    // and restores the counts of the values that are still referenced from outside.
+    static void scan(Nodes &nodes, std::vector<Edge> &stack, const Edge &root)
+    {
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const auto value = stack.back();
+            stack.pop_back();
+
+            auto &current = nodes.find(value.value)->second;
+            if (current.color != Color::Gray) {
+                continue;
+            }
+            if (current.count > 0) {
+                scanBlack(nodes, value);
+                continue;
+            }
+            current.color = Color::White;
+            forEachChild(value, [&](const Edge &child) { stack.push_back(child); });
+        }
+    }
+
+    static void scanBlack(Nodes &nodes, const Edge &root)
+    {
+        nodes.find(root.value)->second.color = Color::Black;
+        std::vector<Edge> stack = { root };
+        while (!stack.empty()) {
+            const auto value = stack.back();
+            stack.pop_back();
+            forEachChild(value, [&](const Edge &child) {
+                auto &childNode = nodes.find(child.value)->second;
+                childNode.count++;
+                if (childNode.color != Color::Black) {
+                    childNode.color = Color::Black;
+                    stack.push_back(child);
+                }
+            });
+        }
+    }
+
+    // trivially destructible, see RcRootBuffer
+    static inline thread_local bool s_collecting = false;
+};
+
+template<typename T, typename Counter>
+void rcPossibleRoot(RcValue<T, Counter> &value)
+{
+    RcCycleCollector::possibleRoot(value);
+}
+
+// Frees the garbage cycles of traceable values of the current thread, see RcCycleCollector.
+// Returns the number of values that were freed.
+inline std::size_t collect_cycles()
+{
+    return RcCycleCollector::collect();
+}
+
+} // namespace Rcpp
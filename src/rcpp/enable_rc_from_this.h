@@ -0,0 +1,47 @@
+#pragma once
+
+#include <rcpp/weak.h>
+
+namespace Rcpp {
+
+// Base class that allows a T to obtain an Rc to itself.
+//
+// Derive T from enable_rc_from_this<T> (CRTP). make_rc<T> (and the other ways to create an Rc<T, Counter>
+// with the same Counter) store a Weak to the new value in it, so member functions can call rc_from_this().
+// Values that are not owned by an Rc return an empty Rc.
+template<typename T, typename Counter>
+class enable_rc_from_this
+{
+public:
+    Rc<T, Counter> rc_from_this() const noexcept
+    {
+        return m_weakThis.lock();
+    }
+
+    Weak<T, Counter> weak_from_this() const noexcept
+    {
+        return m_weakThis;
+    }
+
+protected:
+    enable_rc_from_this() noexcept = default;
+
+    // a copy is owned by a different Rc, if at all
+    enable_rc_from_this(const enable_rc_from_this &) noexcept
+    {
+    }
+
+    enable_rc_from_this &operator=(const enable_rc_from_this &) noexcept
+    {
+        return *this;
+    }
+
+    ~enable_rc_from_this() = default;
+
+private:
+    friend class Rc<T, Counter>;
+
+    mutable Weak<T, Counter> m_weakThis;
+};
+
+} // namespace Rcpp
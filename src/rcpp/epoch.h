@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Rcpp {
+
+// Epoch-based reclamation, see EpochGuard and EpochArc.
+//
+// A global epoch counter advances once every pinned thread has seen its current value. Threads pin
+// the epoch while they read shared values without counting references. Values that are no longer
+// referenced are retired to the limbo list of the retiring thread instead of being destroyed, stamped
+// with the epoch of their retirement. Two epochs later no thread can still read them, so they are
+// destroyed when the retiring thread collects its limbo list.
+//
+// The pinned state of a thread, the shared pointers read while pinned and the epoch checks are all
+// sequentially consistent: a thread that could still read a value is pinned before the value was
+// unlinked, so the advance that would make the value reclaimable sees it pinned.
+//
+// A thread gives up its participant when its thread-local objects are destroyed. Values it retires
+// afterwards, e.g. from the destructor of a static object, are destroyed right away if no thread is
+// pinned, and are otherwise left to the next thread that collects, like the values of exited threads.
+class Epoch
+{
+public:
+    using Drop = void (*)(void *object) noexcept;
+
+    // Pins the epoch of the current thread, pins nest.
+    static void pin()
+    {
+        auto *thread = Participant::current();
+        if (!thread) {
+            // the participant of the thread is gone, borrow one until the pin ends
+            thread = s_current = claim();
+        }
+        if (thread->pins++ == 0) {
+            const auto epoch = s_epoch.load(std::memory_order_seq_cst);
+            // a read-modify-write, so an advance that reads it also acquires the reads of the
+            // previous pin, which ended with the release below
+            thread->state.exchange(pinnedState(epoch), std::memory_order_seq_cst);
+        }
+    }
+
+    static void unpin() noexcept
+    {
+        auto *thread = s_current;
+        assert(thread && thread->pins > 0 && "unpin without pin");
+        if (--thread->pins == 0) {
+            thread->state.store(Unpinned, std::memory_order_release);
+            if (s_exited) {
+                release(*thread);
+            }
+        }
+    }
+
+    // Destroys object with drop once no pinned thread can read it anymore.
+    static void retire(void *object, Drop drop)
+    {
+        const auto epoch = s_epoch.load(std::memory_order_seq_cst);
+        auto *thread = Participant::current();
+        if (!thread) {
+            // the object was unlinked before, threads that pin from now on can not read it anymore
+            if (!anyPinned()) {
+                drop(object);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(s_orphansMutex);
+            s_orphans.push_back({object, drop, epoch});
+            return;
+        }
+        thread->limbo.push_back({object, drop, epoch});
+        if (++thread->retiredSinceCollect >= CollectInterval) {
+            collect(1);
+        }
+    }
+
+    // Tries to advance the epoch the given number of times, then destroys the values retired by this
+    // thread and by exited threads that can no longer be read. Returns the number of destroyed values.
+    static std::size_t collect(int advances)
+    {
+        auto *thread = Participant::current();
+
+        auto epoch = s_epoch.load(std::memory_order_seq_cst);
+        for (int i = 0; i < advances; ++i) {
+            epoch = tryAdvance(epoch);
+        }
+
+        // take the reclaimable values out first, their destructors may retire further values
+        std::vector<Retired> reclaimable;
+        if (thread) {
+            thread->retiredSinceCollect = 0;
+            takeReclaimable(thread->limbo, epoch, reclaimable);
+        }
+        {
+            std::unique_lock<std::mutex> lock(s_orphansMutex, std::try_to_lock);
+            if (lock) {
+                takeReclaimable(s_orphans, epoch, reclaimable);
+            }
+        }
+        for (const auto &retired : reclaimable) {
+            retired.drop(retired.object);
+        }
+        return reclaimable.size();
+    }
+
+    // The number of values retired by the current thread that were not destroyed yet.
+    static std::size_t retired() noexcept
+    {
+        const auto *thread = Participant::current();
+        return thread ? thread->limbo.size() : 0;
+    }
+
+private:
+    struct Retired {
+        void *object;
+        Drop drop;
+        std::uint64_t epoch;
+    };
+
+    // The epoch state of a thread. Participants are never freed, exited threads leave theirs to be
+    // claimed by new threads.
+    struct Participant {
+        // pinnedState(epoch) while pinned, Unpinned otherwise
+        std::atomic<std::uint64_t> state = Unpinned;
+        std::atomic<bool> claimed = true;
+        Participant *next = nullptr;
+
+        // only used by the thread that claimed the participant
+        std::size_t pins = 0;
+        std::size_t retiredSinceCollect = 0;
+        std::vector<Retired> limbo;
+
+        // nullptr once the thread-local objects of the thread are destroyed
+        static Participant *current()
+        {
+            if (!s_current && !s_exited) {
+                static thread_local Holder holder;
+            }
+            return s_current;
+        }
+    };
+
+    // claims a participant for a thread and releases it when the thread exits
+    struct Holder {
+        Holder()
+        {
+            s_current = claim();
+        }
+
+        ~Holder()
+        {
+            assert(s_current->pins == 0 && "A thread exited while pinned");
+            s_exited = true;
+            release(*s_current);
+        }
+    };
+
+    static constexpr std::uint64_t Unpinned = 0;
+    // collect every this many retired values
+    static constexpr std::size_t CollectInterval = 64;
+
+    static std::uint64_t pinnedState(std::uint64_t epoch) noexcept
+    {
+        return (epoch << 1) | 1;
+    }
+
+    static Participant *claim()
+    {
+        auto *head = s_participants.load(std::memory_order_acquire);
+        for (auto *participant = head; participant; participant = participant->next) {
+            bool claimed = false;
+            if (participant->claimed.compare_exchange_strong(claimed, true, std::memory_order_acquire)) {
+                return participant;
+            }
+        }
+        auto *participant = new Participant();
+        participant->next = head;
+        while (!s_participants.compare_exchange_weak(participant->next, participant, std::memory_order_release, std::memory_order_acquire)) { }
+        return participant;
+    }
+
+    // Leaves the values that the thread could not destroy yet to other threads and gives up its participant.
+    static void release(Participant &thread)
+    {
+        collect(1);
+        if (!thread.limbo.empty()) {
+            std::lock_guard<std::mutex> lock(s_orphansMutex);
+            s_orphans.insert(s_orphans.end(), thread.limbo.begin(), thread.limbo.end());
+        }
+        thread.limbo = {};
+        s_current = nullptr;
+        thread.claimed.store(false, std::memory_order_release);
+    }
+
+    static bool anyPinned() noexcept
+    {
+        for (auto *participant = s_participants.load(std::memory_order_acquire); participant; participant = participant->next) {
+            if (participant->state.load(std::memory_order_seq_cst) != Unpinned) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Advances the epoch if every pinned thread has seen it, returns the current epoch.
+    static std::uint64_t tryAdvance(std::uint64_t epoch) noexcept
+    {
+        for (auto *participant = s_participants.load(std::memory_order_acquire); participant; participant = participant->next) {
+            const auto state = participant->state.load(std::memory_order_seq_cst);
+            if (state != Unpinned && state != pinnedState(epoch)) {
+                return s_epoch.load(std::memory_order_seq_cst);
+            }
+        }
+        if (s_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst)) {
+            return epoch + 1;
+        }
+        // another thread advanced it
+        return epoch;
+    }
+
+    // Values retired in epoch e may still be read by threads pinned in epoch e, which can only
+    // advance it to e + 1, so they are safe once the epoch reached e + 2.
+    static void takeReclaimable(std::vector<Retired> &limbo, std::uint64_t epoch, std::vector<Retired> &reclaimable)
+    {
+        auto kept = limbo.begin();
+        for (auto it = limbo.begin(); it != limbo.end(); ++it) {
+            if (it->epoch + 2 <= epoch) {
+                reclaimable.push_back(*it);
+            } else {
+                *kept++ = *it;
+            }
+        }
+        limbo.erase(kept, limbo.end());
+    }
+
+    static inline std::atomic<std::uint64_t> s_epoch = 0;
+    static inline std::atomic<Participant *> s_participants = nullptr;
+    // the values left behind by exited threads
+    static inline std::mutex s_orphansMutex;
+    static inline std::vector<Retired> s_orphans;
+
+    // trivially destructible, so they can still be used while the thread-local objects are destroyed
+    static inline thread_local Participant *s_current = nullptr;
+    static inline thread_local bool s_exited = false;
+};
+
+// Pins the epoch of the current thread while it exists, see Epoch.
+// Values read from an AtomicEpochArc while a guard exists stay alive until it is destroyed.
+class EpochGuard
+{
+public:
+    EpochGuard()
+    {
+        Epoch::pin();
+    }
+
+    ~EpochGuard()
+    {
+        Epoch::unpin();
+    }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
+
+// Advances the epoch if possible and destroys the retired values that no thread can read anymore.
+// Returns the number of destroyed values. Values are also collected while retiring them, call this
+// to reclaim them eagerly, e.g. in idle time.
+inline std::size_t reclaim_retired()
+{
+    // values need two advances to become reclaimable
+    return Epoch::collect(2);
+}
+
+// The number of values retired by the current thread that were not destroyed yet.
+inline std::size_t pending_retired() noexcept
+{
+    return Epoch::retired();
+}
+
+} // namespace Rcpp
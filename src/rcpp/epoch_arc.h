@@ -0,0 +1,211 @@
+#pragma once
+
+#include <rcpp/arc.h>
+#include <rcpp/epoch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace Rcpp {
+
+template<typename T, typename Counter = std::uint32_t>
+class AtomicEpochArc;
+
+// An Arc whose values are reclaimed with epochs, so threads can read them through an AtomicEpochArc
+// without counting a reference.
+//
+// Copies are counted like Arc, but when the last reference is released, the value is retired to the
+// limbo list of the releasing thread (see Epoch) instead of being destroyed right away. It is destroyed
+// once every thread that pinned the epoch before has unpinned it, on the releasing thread.
+// Values released after the thread-local objects of a thread were destroyed, e.g. by a static
+// AtomicEpochArc, are destroyed right away if no thread is pinned.
+// EpochArc does not support weak references.
+template<typename T, typename Counter = std::uint32_t>
+class EpochArc
+{
+public:
+    template<typename U, typename C>
+    friend class AtomicEpochArc;
+
+    EpochArc()
+        : m_value(nullptr)
+    {
+    }
+
+    EpochArc(const EpochArc &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    EpochArc(EpochArc &&other) noexcept
+        : EpochArc()
+    {
+        swap(*this, other);
+    }
+
+    ~EpochArc()
+    {
+        reset();
+    }
+
+    friend void swap(EpochArc &first, EpochArc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    EpochArc &operator=(EpochArc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    // Creates a new value, see make_epoch_arc.
+    template<typename... Args>
+    static EpochArc make(Args &&...args)
+    {
+        static_assert(alignof(ArcValue<T, Counter>) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "EpochArc does not support over-aligned types");
+        return adopt(*new ArcValue<T, Counter>(std::forward<Args>(args)...));
+    }
+
+    void reset()
+    {
+        // A reader may still upgrade the value while it is unique, so the release always needs a
+        // read-modify-write. Without weak references, the last strong reference is the last reference.
+        if (m_value && m_value->releaseShared() != ArcRelease::Kept) {
+            Epoch::retire(m_value, &destroy);
+        }
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return m_value->content();
+    }
+
+    T *operator->() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    ArcValue<T, Counter> *m_value;
+
+    // Takes over a strong reference that was already counted.
+    static EpochArc adopt(ArcValue<T, Counter> &value) noexcept
+    {
+        EpochArc arc;
+        arc.m_value = &value;
+        return arc;
+    }
+
+    static void destroy(void *object) noexcept
+    {
+        auto *value = static_cast<ArcValue<T, Counter> *>(object);
+        value->destructContent();
+        value->deallocate();
+    }
+};
+
+// A cell holding an EpochArc that any thread can load, store and exchange at the same time.
+//
+// Besides counted loads, read(guard) borrows the current value without touching its reference count:
+// the value stays alive while the guard pins the epoch, even if another thread replaces it meanwhile.
+// Reading is then only a load of the pointer, so readers on many threads do not contend.
+template<typename T, typename Counter>
+class AtomicEpochArc
+{
+public:
+    AtomicEpochArc() noexcept
+        : m_value(nullptr)
+    {
+    }
+
+    explicit AtomicEpochArc(EpochArc<T, Counter> arc) noexcept
+        : m_value(std::exchange(arc.m_value, nullptr))
+    {
+    }
+
+    AtomicEpochArc(const AtomicEpochArc &) = delete;
+    AtomicEpochArc &operator=(const AtomicEpochArc &) = delete;
+
+    ~AtomicEpochArc()
+    {
+        if (auto *value = m_value.load(std::memory_order_relaxed)) {
+            EpochArc<T, Counter>::adopt(*value).reset();
+        }
+    }
+
+    // The current value, which stays valid as long as the guard exists. Returns nullptr if the cell is empty.
+    const T *read(const EpochGuard &) const noexcept
+    {
+        auto *value = m_value.load(std::memory_order_seq_cst);
+        return value ? &value->content() : nullptr;
+    }
+
+    EpochArc<T, Counter> load() const
+    {
+        EpochGuard guard;
+        while (auto *value = m_value.load(std::memory_order_seq_cst)) {
+            // the guard keeps the value alive, but it may already have been released by the cell
+            if (value->tryIncrementStrong()) {
+                return EpochArc<T, Counter>::adopt(*value);
+            }
+        }
+        return {};
+    }
+
+    void store(EpochArc<T, Counter> desired)
+    {
+        exchange(std::move(desired));
+    }
+
+    EpochArc<T, Counter> exchange(EpochArc<T, Counter> desired) noexcept
+    {
+        auto *previous = m_value.exchange(std::exchange(desired.m_value, nullptr), std::memory_order_seq_cst);
+        return previous ? EpochArc<T, Counter>::adopt(*previous) : EpochArc<T, Counter>();
+    }
+
+    // Stores desired if the cell holds the same value as expected, otherwise loads the current value into expected.
+    bool compare_exchange_strong(EpochArc<T, Counter> &expected, EpochArc<T, Counter> desired)
+    {
+        auto *previous = expected.m_value;
+        if (m_value.compare_exchange_strong(previous, desired.m_value, std::memory_order_seq_cst)) {
+            desired.m_value = nullptr;
+            // the reference of the cell
+            if (previous) {
+                EpochArc<T, Counter>::adopt(*previous).reset();
+            }
+            return true;
+        }
+        expected = load();
+        return false;
+    }
+
+    bool compare_exchange_weak(EpochArc<T, Counter> &expected, EpochArc<T, Counter> desired)
+    {
+        return compare_exchange_strong(expected, std::move(desired));
+    }
+
+private:
+    std::atomic<ArcValue<T, Counter> *> m_value;
+};
+
+// Creates a new value that is managed by an EpochArc, like make_arc.
+template<typename T, typename... Args>
+EpochArc<T> make_epoch_arc(Args &&...args)
+{
+    return EpochArc<T>::make(std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
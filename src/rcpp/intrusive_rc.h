@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace Rcpp {
+
+template<typename T>
+class IntrusiveRc;
+
+// Base class that embeds the strong reference count into T, so T can be managed by IntrusiveRc.
+//
+// Derive T from IntrusiveRcBase<T> (CRTP). The count is not part of the value of T: copying
+// or assigning a T does not copy it. When the last IntrusiveRc is gone, T::destroyRc(value) is called,
+// which deletes the value by default. Objects that are not allocated with new (e.g. from a pool)
+// must declare a public static destroyRc(T *) that releases them.
+//
+// Weak references are not supported, as the count would be destroyed together with the value.
+// Use make_rc and Weak for values that need weak references.
+template<typename T, typename Counter = std::size_t>
+class IntrusiveRcBase
+{
+    static_assert(std::is_unsigned_v<Counter>, "The counter of an Rc must be an unsigned integer type");
+
+public:
+    Counter strongCount() const noexcept
+    {
+        return m_strong;
+    }
+
+    static void destroyRc(T *value) noexcept
+    {
+        delete value;
+    }
+
+protected:
+    IntrusiveRcBase() noexcept = default;
+
+    IntrusiveRcBase(const IntrusiveRcBase &) noexcept
+    {
+    }
+
+    IntrusiveRcBase &operator=(const IntrusiveRcBase &) noexcept
+    {
+        return *this;
+    }
+
+    ~IntrusiveRcBase() = default;
+
+private:
+    template<typename U>
+    friend class IntrusiveRc;
+
+    void incrementStrong() const noexcept
+    {
+        assert(m_strong != std::numeric_limits<Counter>::max() && "Too many strong references for the Rc counter type");
+        ++m_strong;
+    }
+
+    Counter decrementStrong() const noexcept
+    {
+        return --m_strong;
+    }
+
+    mutable Counter m_strong = 0;
+};
+
+// A reference counted pointer to a T that derives from IntrusiveRcBase.
+//
+// As the count is part of the value, there is no separate control block: an IntrusiveRc is a single
+// pointer, also when it points to a base class, and can be created from any raw pointer to a T,
+// regardless of how the T was allocated.
+template<typename T>
+class IntrusiveRc
+{
+public:
+    template<typename U>
+    friend class IntrusiveRc;
+
+    ~IntrusiveRc()
+    {
+        reset();
+    }
+
+    IntrusiveRc() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    // Takes a new strong reference to value.
+    explicit IntrusiveRc(T *value) noexcept
+        : m_value(value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    IntrusiveRc(IntrusiveRc &&other) noexcept
+        : IntrusiveRc()
+    {
+        swap(*this, other);
+    }
+
+    IntrusiveRc(const IntrusiveRc &other) noexcept
+        : IntrusiveRc(other.m_value)
+    {
+    }
+
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    IntrusiveRc(const IntrusiveRc<U> &other) noexcept
+        : IntrusiveRc(static_cast<T *>(other.m_value))
+    {
+    }
+
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    IntrusiveRc(IntrusiveRc<U> &&other) noexcept
+        : m_value(other.m_value)
+    {
+        other.m_value = nullptr;
+    }
+
+    friend void swap(IntrusiveRc &first, IntrusiveRc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    IntrusiveRc &operator=(IntrusiveRc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    void reset()
+    {
+        if (m_value && m_value->decrementStrong() == 0) {
+            T::destroyRc(m_value);
+        }
+        m_value = nullptr;
+    }
+
+    T *get() const noexcept
+    {
+        return m_value;
+    }
+
+    T &operator*() const noexcept
+    {
+        return *m_value;
+    }
+
+    T *operator->() const noexcept
+    {
+        return m_value;
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    T *m_value;
+};
+
+template<typename T, typename... Args>
+IntrusiveRc<T> make_intrusive_rc(Args &&...args)
+{
+    return IntrusiveRc<T>(new T(std::forward<Args>(args)...));
+}
+
+template<typename Base, typename Derived>
+IntrusiveRc<Base> static_pointer_cast(const IntrusiveRc<Derived> &other)
+{
+    return IntrusiveRc<Base>(static_cast<Base *>(other.get()));
+}
+
+template<typename Derived, typename Base>
+IntrusiveRc<Derived> dynamic_pointer_cast(const IntrusiveRc<Base> &other)
+{
+    return IntrusiveRc<Derived>(dynamic_cast<Derived *>(other.get()));
+}
+
+} // namespace Rcpp
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <rcpp/arc.h>
+
+#include <type_traits>
+#include <typeinfo>
+
+namespace Rcpp {
+
+// forward declaration necessary for friend declarations
+template<typename T, typename Counter = std::uint32_t>
+class PAWeak;
+
+// The thread-safe counterpart of Prc: a polymorphic Arc, which can point to a base class of the value.
+template<typename T, typename Counter>
+class Parc
+{
+public:
+    template<typename U, typename C>
+    friend class PAWeak;
+
+    template<typename Base, typename Derived, typename C>
+    friend Parc<Base, C> static_pointer_cast(const Parc<Derived, C> &);
+
+    template<typename Base, typename Derived, typename C>
+    friend Parc<Base, C> static_pointer_cast(Parc<Derived, C> &&);
+
+    template<typename Derived, typename Base, typename C>
+    friend Parc<Derived, C> dynamic_pointer_cast(const Parc<Base, C> &);
+
+    template<typename Derived, typename Base, typename C>
+    friend Parc<Derived, C> dynamic_pointer_cast(Parc<Base, C> &&);
+
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, C>> dynamic_base_pointer_cast(const Parc<Base, C> &);
+
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, C>> dynamic_base_pointer_cast(Parc<Base, C> &&);
+
+    Parc()
+        : m_controlBlock(nullptr), m_value(nullptr)
+    {
+    }
+
+    friend void swap(Parc &first, Parc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_controlBlock, second.m_controlBlock);
+        swap(first.m_value, second.m_value);
+    }
+
+    Parc(const Parc &other) noexcept
+        : m_controlBlock(other.m_controlBlock), m_value(other.m_value)
+    {
+        if (m_controlBlock) {
+            m_controlBlock->incrementStrong();
+        }
+    }
+
+    Parc(Parc &&other) noexcept
+        : Parc()
+    {
+        swap(*this, other);
+    }
+
+    Parc &operator=(Parc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    Parc(const Arc<T, Counter> &arc) noexcept
+        : m_controlBlock(arc.m_value), m_value(arc ? &*arc : nullptr)
+    {
+        if (m_controlBlock) {
+            m_controlBlock->incrementStrong();
+        }
+    }
+
+    Parc(Arc<T, Counter> &&arc) noexcept
+        : m_controlBlock(arc.m_value), m_value(arc ? &*arc : nullptr)
+    {
+        arc.m_value = nullptr;
+    }
+
+    ~Parc()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (m_controlBlock) {
+            const auto release = m_controlBlock->releaseStrong();
+            if (release != ArcRelease::Kept) {
+                m_value->~T();
+
+                // all strong references destructed, remove the implicit weak reference
+                if (release == ArcRelease::LastReference || m_controlBlock->decrementWeak() == 0) {
+                    m_controlBlock->deallocate();
+                }
+            }
+        }
+        m_controlBlock = nullptr;
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return *m_value;
+    }
+
+    T *operator->() const noexcept
+    {
+        return m_value;
+    }
+
+    operator bool() const
+    {
+        return m_controlBlock;
+    }
+
+private:
+    // for construction by ptr_cast
+    Parc(ArcControlBlock<Counter> *controlBlock, T *value)
+        : m_controlBlock(value ? controlBlock : nullptr), m_value(value)
+    {
+    }
+
+    ArcControlBlock<Counter> *m_controlBlock;
+    T *m_value;
+};
+
+template<typename T, typename... Args>
+Parc<T> make_parc(Args &&...args)
+{
+    return make_arc<T>(std::forward<Args>(args)...);
+}
+
+template<typename Base, typename Derived, typename Counter>
+Parc<Base, Counter> static_pointer_cast(const Parc<Derived, Counter> &other)
+{
+    Parc<Base, Counter> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
+    if (result.m_controlBlock) {
+        result.m_controlBlock->incrementStrong();
+    }
+    return result;
+}
+
+template<typename Base, typename Derived, typename Counter>
+Parc<Base, Counter> static_pointer_cast(Parc<Derived, Counter> &&other)
+{
+    Parc<Base, Counter> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
+    other.m_controlBlock = nullptr;
+    other.m_value = nullptr;
+    return result;
+}
+
+template<typename Base, typename Derived, typename Counter>
+Parc<Base, Counter> static_pointer_cast(const Arc<Derived, Counter> &arc)
+{
+    return static_pointer_cast<Base>(Parc<Derived, Counter>(arc));
+}
+
+template<typename Base, typename Derived, typename Counter>
+Parc<Base, Counter> static_pointer_cast(Arc<Derived, Counter> &&arc)
+{
+    return static_pointer_cast<Base>(Parc<Derived, Counter>(std::move(arc)));
+}
+
+template<typename Derived, typename Base, typename Counter>
+Parc<Derived, Counter> dynamic_pointer_cast(const Parc<Base, Counter> &other)
+{
+    Parc<Derived, Counter> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
+    if (result.m_controlBlock) {
+        result.m_controlBlock->incrementStrong();
+    }
+    return result;
+}
+
+template<typename Derived, typename Base, typename Counter>
+Parc<Derived, Counter> dynamic_pointer_cast(Parc<Base, Counter> &&other)
+{
+    Parc<Derived, Counter> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
+    // only transfer the reference if the cast was successful
+    if (result.m_controlBlock) {
+        other.m_controlBlock = nullptr;
+        other.m_value = nullptr;
+    }
+    return result;
+}
+
+// Like dynamic_base_pointer_cast for Prc: converts a Parc back to an Arc if the dynamic type of its
+// value is exactly Derived. Base must be polymorphic.
+template<typename Derived, typename Base, typename Counter>
+std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, Counter>> dynamic_base_pointer_cast(const Parc<Base, Counter> &parc)
+{
+    if (parc && typeid(*parc.m_value) == typeid(Derived)) {
+        return Arc<Derived, Counter>(*static_cast<ArcValue<Derived, Counter> *>(parc.m_controlBlock));
+    }
+    return {};
+}
+
+template<typename Derived, typename Base, typename Counter>
+std::enable_if_t<std::is_polymorphic_v<Base>, Arc<Derived, Counter>> dynamic_base_pointer_cast(Parc<Base, Counter> &&parc)
+{
+    if (parc && typeid(*parc.m_value) == typeid(Derived)) {
+        auto result = Arc<Derived, Counter>::adopt(*static_cast<ArcValue<Derived, Counter> *>(parc.m_controlBlock));
+        parc.m_controlBlock = nullptr;
+        parc.m_value = nullptr;
+        return result;
+    }
+    return {};
+}
+
+} // namespace Rcpp
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <rcpp/parc.h>
+
+namespace Rcpp {
+
+// The thread-safe counterpart of Pweak, a weak reference to the value of a Parc.
+template<typename T, typename Counter>
+class PAWeak
+{
+public:
+    PAWeak()
+        : m_controlBlock(nullptr), m_value(nullptr)
+    {
+    }
+
+    PAWeak(const Parc<T, Counter> &parc)
+        : m_controlBlock(parc.m_controlBlock), m_value(parc.m_value)
+    {
+        if (m_controlBlock) {
+            m_controlBlock->incrementWeak();
+        }
+    }
+
+    PAWeak(const PAWeak &other)
+        : m_controlBlock(other.m_controlBlock), m_value(other.m_value)
+    {
+        if (m_controlBlock) {
+            m_controlBlock->incrementWeak();
+        }
+    }
+
+    PAWeak(PAWeak &&other)
+        : PAWeak()
+    {
+        swap(*this, other);
+    }
+
+    friend void swap(PAWeak &first, PAWeak &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_controlBlock, second.m_controlBlock);
+        swap(first.m_value, second.m_value);
+    }
+
+    PAWeak &operator=(PAWeak other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    PAWeak &operator=(const Parc<T, Counter> &parc)
+    {
+        reset();
+        m_controlBlock = parc.m_controlBlock;
+        m_value = parc.m_value;
+        if (m_controlBlock) {
+            m_controlBlock->incrementWeak();
+        }
+        return *this;
+    }
+
+    ~PAWeak()
+    {
+        reset();
+    }
+
+    Parc<T, Counter> lock() const noexcept
+    {
+        if (m_controlBlock && m_controlBlock->tryIncrementStrong()) {
+            return Parc<T, Counter>(m_controlBlock, m_value);
+        }
+        return {};
+    }
+
+    void reset()
+    {
+        if (m_controlBlock && m_controlBlock->decrementWeak() == 0) {
+            m_controlBlock->deallocate();
+        }
+        m_controlBlock = nullptr;
+        m_value = nullptr;
+    }
+
+private:
+    ArcControlBlock<Counter> *m_controlBlock;
+    T *m_value;
+};
+
+} // namespace Rcpp
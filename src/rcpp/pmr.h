@@ -0,0 +1,28 @@
+#pragma once
+
+#include <rcpp/prc.h>
+#include <rcpp/rc.h>
+
+#include <memory_resource>
+
+namespace Rcpp {
+
+// Creates an Rc whose control block and value are allocated from the given memory resource.
+// The resource is remembered in the control block and the memory is returned to it once the
+// last weak reference is gone, no matter whether that is a Rc, Prc, Weak or Pweak.
+// The resource must outlive all references to the value.
+//
+// Allocator-aware content types (e.g. std::pmr::vector) are constructed with the resource as well.
+template<typename T, typename... Args>
+Rc<T> make_rc_pmr(std::pmr::memory_resource *resource, Args &&...args)
+{
+    return allocate_rc<T>(std::pmr::polymorphic_allocator<T>(resource), std::forward<Args>(args)...);
+}
+
+template<typename T, typename... Args>
+Prc<T> make_prc_pmr(std::pmr::memory_resource *resource, Args &&...args)
+{
+    return make_rc_pmr<T>(resource, std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
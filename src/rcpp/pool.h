@@ -0,0 +1,300 @@
+#pragma once
+
+#include <rcpp/rc.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+
+namespace Rcpp {
+
+// Hands out fixed size blocks, which are carved out of page-sized slabs.
+// Free blocks are kept in an intrusive free list per slab, so allocating and freeing a block
+// is just a pointer swap and memory is only requested from the system once per slab.
+//
+// Slabs are aligned to their own size, so the slab of a block is found by masking its address.
+// Slabs that become completely empty are kept for reuse until trim() is called.
+//
+// There is one pool per block size and alignment, shared by all threads and all types with that
+// block size. Each pool is guarded by a spin lock, so an Rc can be created on one thread and released
+// on another, and threads that only use their own Rcs can allocate from the same pool at the same time.
+// The lock is uncontended unless two threads use the pool at the very same moment, in which case
+// they are serialized. The pool is trivially destructible, so values can still be released while
+// static objects are destroyed.
+template<std::size_t BlockSize, std::size_t BlockAlignment>
+class RcSlabPool
+{
+    struct Slab {
+        Slab *previous;
+        Slab *next;
+        void *freeList;
+        std::size_t used;
+        std::size_t carved;
+    };
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    class Lock
+    {
+    public:
+        explicit Lock(std::atomic<bool> &locked) noexcept
+            : m_locked(locked)
+        {
+            while (m_locked.exchange(true, std::memory_order_acquire)) {
+                // wait without writing, so the cache line is not bounced between the waiting threads
+                while (m_locked.load(std::memory_order_relaxed)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        Lock(const Lock &) = delete;
+        Lock &operator=(const Lock &) = delete;
+
+        ~Lock()
+        {
+            m_locked.store(false, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<bool> &m_locked;
+    };
+
+    static constexpr std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr std::size_t Alignment = BlockAlignment > alignof(FreeBlock) ? BlockAlignment : alignof(FreeBlock);
+    static constexpr std::size_t Stride = alignUp(BlockSize > sizeof(FreeBlock) ? BlockSize : sizeof(FreeBlock), Alignment);
+    static constexpr std::size_t FirstBlock = alignUp(sizeof(Slab), Alignment);
+
+    static constexpr std::size_t slabSizeFor(std::size_t minimumBlocks)
+    {
+        std::size_t size = 4096;
+        while (size < FirstBlock + minimumBlocks * Stride) {
+            size *= 2;
+        }
+        return size;
+    }
+
+public:
+    // A page, unless the blocks are so large that fewer than 8 of them would fit.
+    static constexpr std::size_t SlabSize = slabSizeFor(8);
+    static constexpr std::size_t BlocksPerSlab = (SlabSize - FirstBlock) / Stride;
+
+    constexpr RcSlabPool() noexcept = default;
+    RcSlabPool(const RcSlabPool &) = delete;
+    RcSlabPool &operator=(const RcSlabPool &) = delete;
+
+    static RcSlabPool &instance() noexcept
+    {
+        return s_instance;
+    }
+
+    void *allocate()
+    {
+        Lock lock(m_locked);
+        if (!m_available) {
+            pushAvailable(newSlab());
+        }
+
+        Slab *slab = m_available;
+        void *block;
+        if (slab->freeList) {
+            block = slab->freeList;
+            slab->freeList = static_cast<FreeBlock *>(block)->next;
+        } else {
+            block = reinterpret_cast<char *>(slab) + FirstBlock + slab->carved * Stride;
+            slab->carved++;
+        }
+
+        if (++slab->used == BlocksPerSlab) {
+            removeAvailable(slab);
+        }
+        m_blocksInUse++;
+        return block;
+    }
+
+    void deallocate(void *block) noexcept
+    {
+        Slab *slab = slabOf(block);
+
+        Lock lock(m_locked);
+        auto *freeBlock = static_cast<FreeBlock *>(block);
+        freeBlock->next = static_cast<FreeBlock *>(slab->freeList);
+        slab->freeList = freeBlock;
+
+        if (slab->used-- == BlocksPerSlab) {
+            pushAvailable(slab);
+        }
+        m_blocksInUse--;
+    }
+
+    // Returns all slabs without any allocated blocks to the system allocator.
+    // Returns the number of released slabs.
+    std::size_t trim() noexcept
+    {
+        Lock lock(m_locked);
+        std::size_t released = 0;
+        Slab *slab = m_available;
+        while (slab) {
+            Slab *next = slab->next;
+            if (slab->used == 0) {
+                removeAvailable(slab);
+                ::operator delete(static_cast<void *>(slab), std::align_val_t(SlabSize));
+                m_slabs--;
+                released++;
+            }
+            slab = next;
+        }
+        return released;
+    }
+
+    std::size_t slabs() noexcept
+    {
+        Lock lock(m_locked);
+        return m_slabs;
+    }
+
+    std::size_t blocksInUse() noexcept
+    {
+        Lock lock(m_locked);
+        return m_blocksInUse;
+    }
+
+private:
+    static Slab *slabOf(void *block) noexcept
+    {
+        return reinterpret_cast<Slab *>(reinterpret_cast<std::uintptr_t>(block) & ~(std::uintptr_t(SlabSize) - 1));
+    }
+
+    Slab *newSlab()
+    {
+        void *memory = ::operator new(SlabSize, std::align_val_t(SlabSize));
+        m_slabs++;
+        return ::new (memory) Slab{ nullptr, nullptr, nullptr, 0, 0 };
+    }
+
+    void pushAvailable(Slab *slab) noexcept
+    {
+        slab->previous = nullptr;
+        slab->next = m_available;
+        if (m_available) {
+            m_available->previous = slab;
+        }
+        m_available = slab;
+    }
+
+    void removeAvailable(Slab *slab) noexcept
+    {
+        if (slab->previous) {
+            slab->previous->next = slab->next;
+        } else {
+            m_available = slab->next;
+        }
+        if (slab->next) {
+            slab->next->previous = slab->previous;
+        }
+    }
+
+    // slabs that have at least one free block
+    Slab *m_available = nullptr;
+    std::size_t m_slabs = 0;
+    std::size_t m_blocksInUse = 0;
+    std::atomic<bool> m_locked = false;
+
+    static RcSlabPool s_instance;
+};
+
+template<std::size_t BlockSize, std::size_t BlockAlignment>
+RcSlabPool<BlockSize, BlockAlignment> RcSlabPool<BlockSize, BlockAlignment>::s_instance;
+
+// A stateless allocator that allocates single objects from the RcSlabPool for their size.
+// Used by make_rc_pooled, but it can be passed to allocate_rc as well.
+template<typename T>
+class RcPoolAllocator
+{
+public:
+    using value_type = T;
+
+    RcPoolAllocator() noexcept = default;
+
+    template<typename U>
+    RcPoolAllocator(const RcPoolAllocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (n == 1) {
+            return static_cast<T *>(RcSlabPool<sizeof(T), alignof(T)>::instance().allocate());
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *pointer, std::size_t n) noexcept
+    {
+        if (n == 1) {
+            RcSlabPool<sizeof(T), alignof(T)>::instance().deallocate(pointer);
+        } else {
+            std::allocator<T>().deallocate(pointer, n);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const RcPoolAllocator<U> &) const noexcept
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const RcPoolAllocator<U> &) const noexcept
+    {
+        return false;
+    }
+};
+
+// Access to the pool that make_rc_pooled<T> allocates from.
+// Types whose control blocks have the same size and alignment share a pool.
+// Rcs with a different Counter can be allocated from a pool with Rc<T, Counter>::allocate(RcPoolAllocator<T>()).
+template<typename T, typename Counter = std::size_t>
+class RcPool
+{
+    using Block = typename RcAllocatedValue<T, Counter, RcPoolAllocator<T>>::Block;
+    using Pool = RcSlabPool<sizeof(Block), alignof(Block)>;
+
+public:
+    static constexpr std::size_t BlocksPerSlab = Pool::BlocksPerSlab;
+
+    static std::size_t trim() noexcept
+    {
+        return Pool::instance().trim();
+    }
+
+    static std::size_t slabs() noexcept
+    {
+        return Pool::instance().slabs();
+    }
+
+    static std::size_t blocksInUse() noexcept
+    {
+        return Pool::instance().blocksInUse();
+    }
+};
+
+// Like make_rc, but the control block is allocated from a slab pool, which is a lot
+// cheaper than a general purpose heap allocation when many values of the same type are created.
+// Empty slabs are only returned to the system when RcPool<T>::trim() is called.
+template<typename T, typename... Args>
+Rc<T> make_rc_pooled(Args &&...args)
+{
+    return allocate_rc<T>(RcPoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
@@ -3,40 +3,48 @@
 #include <iomanip>
 #include <rcpp/rc.h>
 #include <type_traits>
+#include <typeinfo>
 
 namespace Rcpp {
 
-template<typename T>
+// forward declaration necessary for friend declarations
+template<typename T, typename Counter = std::size_t>
+class Pweak;
+
+template<typename T, typename Counter>
 class Prc
 {
 public:
-    template<typename U>
+    template<typename U, typename C>
     friend class Pweak;
 
-    template<typename Base, typename Derived>
-    friend Prc<Base> static_pointer_cast(const Prc<Derived> &);
+    template<typename Base, typename Derived, typename C>
+    friend Prc<Base, C> static_pointer_cast(const Prc<Derived, C> &);
+
+    template<typename Base, typename Derived, typename C>
+    friend Prc<Base, C> static_pointer_cast(Prc<Derived, C> &&);
 
-    template<typename Base, typename Derived>
-    friend Prc<Base> static_pointer_cast(Prc<Derived> &&);
+    template<typename Derived, typename Base, typename C>
+    friend Prc<Derived, C> dynamic_pointer_cast(const Prc<Base, C> &);
 
-    template<typename Derived, typename Base>
-    friend Prc<Derived> dynamic_pointer_cast(const Prc<Base> &);
+    template<typename Derived, typename Base, typename C>
+    friend Prc<Derived, C> dynamic_pointer_cast(Prc<Base, C> &&);
 
-    template<typename Derived, typename Base>
-    friend Prc<Derived> dynamic_pointer_cast(Prc<Base> &&);
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, C>> dynamic_base_pointer_cast(const Prc<Base, C> &);
 
-    template<typename Derived, typename Base>
-    friend Rc<Derived> dynamic_base_pointer_cast(const Prc<Base> &);
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, C>> dynamic_base_pointer_cast(Prc<Base, C> &&);
 
-    template<typename Derived, typename Base>
-    friend Rc<Derived> dynamic_base_pointer_cast(Prc<Base> &&);
+    template<typename U, typename C>
+    friend U *get_mut(Prc<U, C> &) noexcept;
 
     Prc()
         : m_controlBlock(nullptr), m_value(nullptr)
     {
     }
 
-    friend void swap(Prc<T> &first, Prc<T> &second) noexcept
+    friend void swap(Prc &first, Prc &second) noexcept
     {
         using std::swap;
 
@@ -44,7 +52,7 @@ public:
         swap(first.m_value, second.m_value);
     }
 
-    Prc(const Prc<T> &other) noexcept
+    Prc(const Prc &other) noexcept
         : m_controlBlock(other.m_controlBlock), m_value(other.m_value)
     {
         if (m_controlBlock) {
@@ -52,19 +60,19 @@ public:
         }
     }
 
-    Prc(Prc<T> &&other) noexcept
+    Prc(Prc &&other) noexcept
         : Prc()
     {
         swap(*this, other);
     }
 
-    Prc &operator=(Prc<T> other) noexcept
+    Prc &operator=(Prc other) noexcept
     {
         swap(*this, other);
         return *this;
     }
 
-    Prc(const Rc<T> &rc) noexcept
+    Prc(const Rc<T, Counter> &rc) noexcept
         : m_controlBlock(rc.m_value), m_value(rc ? &*rc : nullptr)
     {
         if (m_controlBlock) {
@@ -72,7 +80,7 @@ public:
         }
     }
 
-    Prc(Rc<T> &&rc) noexcept
+    Prc(Rc<T, Counter> &&rc) noexcept
         : m_controlBlock(rc.m_value), m_value(rc ? &*rc : nullptr)
     {
         rc.m_value = nullptr;
@@ -87,13 +95,8 @@ public:
     {
         if (m_controlBlock) {
             if (m_controlBlock->decrementStrong() == 0) {
-                m_value->~T();
-
-                // all strong references destructed, remove the implicit weak
-                // reference
-                if (m_controlBlock->decrementWeak() == 0) {
-                    delete m_controlBlock;
-                }
+                // destroys the value and removes the implicit weak reference, see Rc::reset
+                RcDropQueue::release(*m_controlBlock, m_value);
             }
         }
         m_controlBlock = nullptr;
@@ -117,12 +120,12 @@ public:
 
 private:
     // for construction by ptr_cast
-    Prc(RcControlBlock *controlBlock, T *value)
+    Prc(RcControlBlock<Counter> *controlBlock, T *value)
         : m_controlBlock(value ? controlBlock : nullptr), m_value(value)
     {
     }
 
-    RcControlBlock *m_controlBlock;
+    RcControlBlock<Counter> *m_controlBlock;
     T *m_value;
 };
 
@@ -132,51 +135,51 @@ Prc<T> make_prc(Args &&...args)
     return make_rc<T>(std::forward<Args>(args)...);
 }
 
-template<typename Base, typename Derived>
-Prc<Base> static_pointer_cast(const Prc<Derived> &other)
+template<typename Base, typename Derived, typename Counter>
+Prc<Base, Counter> static_pointer_cast(const Prc<Derived, Counter> &other)
 {
-    Prc<Base> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
+    Prc<Base, Counter> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
     if (result.m_controlBlock) {
         result.m_controlBlock->incrementStrong();
     }
     return result;
 }
 
-template<typename Base, typename Derived>
-Prc<Base> static_pointer_cast(Prc<Derived> &&other)
+template<typename Base, typename Derived, typename Counter>
+Prc<Base, Counter> static_pointer_cast(Prc<Derived, Counter> &&other)
 {
-    Prc<Base> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
+    Prc<Base, Counter> result(other.m_controlBlock, static_cast<Base *>(other.m_value));
     other.m_controlBlock = nullptr;
     other.m_value = nullptr;
     return result;
 }
 
-template<typename Base, typename Derived>
-Prc<Base> static_pointer_cast(const Rc<Derived> &rc)
+template<typename Base, typename Derived, typename Counter>
+Prc<Base, Counter> static_pointer_cast(const Rc<Derived, Counter> &rc)
 {
-    return static_pointer_cast<Base>(Prc<Derived>(rc));
+    return static_pointer_cast<Base>(Prc<Derived, Counter>(rc));
 }
 
-template<typename Base, typename Derived>
-Prc<Base> static_pointer_cast(Rc<Derived> &&rc)
+template<typename Base, typename Derived, typename Counter>
+Prc<Base, Counter> static_pointer_cast(Rc<Derived, Counter> &&rc)
 {
-    return static_pointer_cast<Base>(Prc<Derived>(std::move(rc)));
+    return static_pointer_cast<Base>(Prc<Derived, Counter>(std::move(rc)));
 }
 
-template<typename Derived, typename Base>
-Prc<Derived> dynamic_pointer_cast(const Prc<Base> &other)
+template<typename Derived, typename Base, typename Counter>
+Prc<Derived, Counter> dynamic_pointer_cast(const Prc<Base, Counter> &other)
 {
-    Prc<Derived> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
+    Prc<Derived, Counter> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
     if (result.m_controlBlock) {
         result.m_controlBlock->incrementStrong();
     }
     return result;
 }
 
-template<typename Derived, typename Base>
-Prc<Derived> dynamic_pointer_cast(Prc<Base> &&other)
+template<typename Derived, typename Base, typename Counter>
+Prc<Derived, Counter> dynamic_pointer_cast(Prc<Base, Counter> &&other)
 {
-    Prc<Derived> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
+    Prc<Derived, Counter> result(other.m_controlBlock, dynamic_cast<Derived *>(other.m_value));
     // only transfer the ownership of this reference if the dynamic cast was succesful
     // otherwise the other pointer will still need to decrement its ref-count
     if (result.m_controlBlock) {
@@ -186,30 +189,47 @@ Prc<Derived> dynamic_pointer_cast(Prc<Base> &&other)
     return result;
 }
 
-template<typename Derived, typename Base>
-Rc<Derived> dynamic_base_pointer_cast(const Prc<Base> &prc)
+// Like get_mut for Rc: returns a pointer to the value of prc that can be used to modify it,
+// if prc is the only reference to the value. The value can not be moved out of a Prc, as its
+// dynamic type is unknown. Use dynamic_base_pointer_cast and try_unwrap instead.
+//
+// Like for Rc, the Weak of enable_rc_from_this<T> does not count. If only the dynamic type of the value
+// derives from enable_rc_from_this, its Weak can not be told apart from others and nullptr is returned.
+template<typename T, typename Counter>
+T *get_mut(Prc<T, Counter> &prc) noexcept
 {
-    auto *controlValue = dynamic_cast<RcValue<Derived> *>(prc.m_controlBlock);
-    if (controlValue) {
-        return Rc<Derived>(*controlValue);
+    constexpr Counter OwnWeak = std::is_base_of_v<enable_rc_from_this<T, Counter>, T> ? 2 : 1;
+    if (prc && prc.m_controlBlock->strong() == 1 && prc.m_controlBlock->weak() == OwnWeak) {
+        return prc.m_value;
+    }
+    return nullptr;
+}
+
+// The value of an Rc<T> is always a complete T, so a Prc can be converted back
+// to an Rc if the dynamic type of its value is exactly Derived.
+// Base must be polymorphic, otherwise typeid only knows the static type and the dynamic type can not be checked.
+template<typename Derived, typename Base, typename Counter>
+std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, Counter>> dynamic_base_pointer_cast(const Prc<Base, Counter> &prc)
+{
+    if (prc && typeid(*prc.m_value) == typeid(Derived)) {
+        return Rc<Derived, Counter>(*static_cast<RcValue<Derived, Counter> *>(prc.m_controlBlock));
     }
     return {};
 }
 
-template<typename Derived, typename Base>
-Rc<Derived> dynamic_base_pointer_cast(Prc<Base> &&prc)
+template<typename Derived, typename Base, typename Counter>
+std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, Counter>> dynamic_base_pointer_cast(Prc<Base, Counter> &&prc)
 {
-    auto *controlValue = dynamic_cast<RcValue<Derived> *>(prc.m_controlBlock);
-    if (controlValue) {
-        Rc<Derived> result;
-        result.m_value = controlValue;
+    Rc<Derived, Counter> result;
+    if (prc && typeid(*prc.m_value) == typeid(Derived)) {
+        result.m_value = static_cast<RcValue<Derived, Counter> *>(prc.m_controlBlock);
 
         // only move out of the prc if the cast was actually succesful.
         // Otherwise the prc will have to decrement it's own ref count, so leave it as is.
         prc.m_controlBlock = nullptr;
         prc.m_value = nullptr;
     }
-    return {};
+    return result;
 }
 
 } // namespace Rcpp
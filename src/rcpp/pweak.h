@@ -5,7 +5,7 @@
 
 namespace Rcpp {
 
-template<typename T>
+template<typename T, typename Counter>
 class Pweak
 {
 public:
@@ -14,7 +14,7 @@ public:
     {
     }
 
-    Pweak(const Prc<T> &prc)
+    Pweak(const Prc<T, Counter> &prc)
         : m_controlBlock(prc.m_controlBlock), m_value(prc.m_value)
     {
         if (m_controlBlock) {
@@ -22,7 +22,7 @@ public:
         }
     }
 
-    Pweak(const Pweak<T> &other)
+    Pweak(const Pweak &other)
         : m_controlBlock(other.m_controlBlock), m_value(other.m_value)
     {
         if (m_controlBlock) {
@@ -30,13 +30,13 @@ public:
         }
     }
 
-    Pweak(Pweak<T> &&other)
+    Pweak(Pweak &&other)
         : Pweak()
     {
         swap(*this, other);
     }
 
-    friend void swap(Pweak<T> &first, Pweak<T> &second) noexcept
+    friend void swap(Pweak &first, Pweak &second) noexcept
     {
         using std::swap;
 
@@ -44,13 +44,13 @@ public:
         swap(first.m_value, second.m_value);
     }
 
-    Pweak &operator=(Pweak<T> other)
+    Pweak &operator=(Pweak other)
     {
         swap(*this, other);
         return *this;
     }
 
-    Pweak &operator=(const Prc<T> &prc)
+    Pweak &operator=(const Prc<T, Counter> &prc)
     {
         reset();
         m_controlBlock = prc.m_controlBlock;
@@ -66,10 +66,10 @@ public:
         reset();
     }
 
-    Prc<T> lock() const noexcept
+    Prc<T, Counter> lock() const noexcept
     {
         if (m_controlBlock && m_controlBlock->strong()) {
-            Prc<T> result(m_controlBlock, m_value);
+            Prc<T, Counter> result(m_controlBlock, m_value);
             if (result.m_controlBlock) {
                 result.m_controlBlock->incrementStrong();
             }
@@ -83,7 +83,7 @@ public:
     {
         if (m_controlBlock) {
             if (m_controlBlock->decrementWeak() == 0) {
-                delete m_controlBlock;
+                m_controlBlock->deallocate();
             }
         }
         m_controlBlock = nullptr;
@@ -91,7 +91,7 @@ public:
     }
 
 private:
-    RcControlBlock *m_controlBlock;
+    RcControlBlock<Counter> *m_controlBlock;
     T *m_value;
 };
 
@@ -1,53 +1,247 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace Rcpp {
 
+// Whether Rc stores values of type T in an allocation separate from the control block.
+//
+// Usually the value lives inline in the control block, so its memory stays allocated until the last
+// weak reference is gone. Separately stored values are freed as soon as the last strong reference is
+// gone, only the small control block is kept alive by weak references.
+// By default this applies to values of at least 1 KiB. Specialize this template to change the choice
+// for a type explicitly.
+template<typename T>
+struct RcSeparateContent : std::bool_constant<(sizeof(T) >= 1024)> {
+};
+
+// Type-erased operations on a traceable value, defined in rcpp/cycles.h.
+struct RcCollectableOps;
+
 namespace {
 
+// Which part of a block with custom deallocation to free.
+enum class RcDeallocation {
+    // only the memory of separately stored content, the content is already destructed
+    Content,
+    // the control block itself
+    ControlBlock,
+};
+
+// Frees (part of) a control block that was not allocated by plain new, see RcAllocatedValue.
+using RcDeallocateFunction = void (*)(void *controlBlock, RcDeallocation what);
+
+// The values that the current thread buffered as possible roots of garbage cycles, see rcpp/cycles.h.
+//
+// The buffer does not keep its values alive: buffered control blocks are flagged and remove themselves
+// from it when their memory is freed. It is defined here, as code that does not include rcpp/cycles.h
+// may free a buffered value.
+class RcRootBuffer
+{
+public:
+    // the control block of each buffered value, with the operations on its value
+    using Roots = std::unordered_map<void *, const RcCollectableOps *>;
+
+    // The buffer of the current thread, nullptr once it was destroyed at the exit of the thread.
+    static Roots *roots() noexcept
+    {
+        auto &current = state();
+        if (!current.buffer && !current.finished) {
+            static thread_local Buffer buffer;
+            current.buffer = &buffer;
+        }
+        return current.buffer ? &current.buffer->roots : nullptr;
+    }
+
+    // Removes a control block whose memory is about to be freed.
+    static void forget(void *controlBlock) noexcept
+    {
+        if (auto *current = state().buffer) {
+            current->roots.erase(controlBlock);
+        }
+    }
+
+private:
+    struct Buffer {
+        ~Buffer()
+        {
+            // the blocks stay flagged, but forget ignores them from now on
+            auto &current = state();
+            current.buffer = nullptr;
+            current.finished = true;
+        }
+
+        Roots roots;
+    };
+
+    // Trivially destructible, so blocks can still be freed while the thread-local and static objects
+    // of the thread are destroyed, see RcDropQueue.
+    struct State {
+        Buffer *buffer = nullptr;
+        bool finished = false;
+    };
+
+    static State &state() noexcept
+    {
+        static thread_local State state;
+        return state;
+    }
+};
+
+// The reference counts of a value managed by Rc/Prc.
+//
+// The control block deliberately has no virtual functions, so it does not carry a vtable pointer.
+// Rc<T> knows the exact type of its value and destroys it directly, Prc<T> destroys it through the
+// destructor of T. How the memory of the block is freed is recorded in the lowest bit of the weak count:
+// Blocks allocated with new are freed with operator delete. Blocks with custom deallocation
+// are directly preceded by the RcDeallocateFunction that frees them and their separately stored content.
+// The second lowest bit flags blocks that are buffered as possible roots of a cycle, see RcRootBuffer.
+//
+// Counter is the type of the two counts. Smaller counters make the block smaller, but limit the
+// number of references: at most the maximum of Counter strong and a quarter of it weak references.
+// Debug builds assert that the counts do not overflow.
+template<typename Counter>
 class RcControlBlock
 {
-    size_t m_weak = 0;
-    size_t m_strong = 0;
+    static_assert(std::is_unsigned_v<Counter>, "The counter of an Rc must be an unsigned integer type");
 
-public:
-    virtual ~RcControlBlock() = default;
+    static constexpr Counter CustomDeallocation = 1;
+    static constexpr Counter Buffered = 2;
+    static constexpr Counter WeakIncrement = 4;
+
+    Counter m_weak = 0;
+    Counter m_strong = 0;
 
-    size_t incrementStrong()
+public:
+    Counter incrementStrong()
     {
+        assert(m_strong != std::numeric_limits<Counter>::max() && "Too many strong references for the Rc counter type");
         return ++m_strong;
     }
 
-    size_t incrementWeak()
+    Counter incrementWeak()
     {
-        return ++m_weak;
+        assert(m_weak <= std::numeric_limits<Counter>::max() - WeakIncrement && "Too many weak references for the Rc counter type");
+        m_weak += WeakIncrement;
+        return weak();
     }
 
-    size_t decrementStrong()
+    Counter decrementStrong()
     {
         return --m_strong;
     }
 
-    size_t decrementWeak()
+    Counter decrementWeak()
     {
-        return --m_weak;
+        m_weak -= WeakIncrement;
+        return weak();
     }
 
-    size_t strong()
+    Counter strong()
     {
         return m_strong;
     }
 
-    size_t weak()
+    Counter weak()
+    {
+        return m_weak / WeakIncrement;
+    }
+
+    bool hasCustomDeallocation() const noexcept
+    {
+        return m_weak & CustomDeallocation;
+    }
+
+    void setCustomDeallocation() noexcept
+    {
+        m_weak |= CustomDeallocation;
+    }
+
+    bool isBuffered() const noexcept
+    {
+        return m_weak & Buffered;
+    }
+
+    void setBuffered() noexcept
+    {
+        m_weak |= Buffered;
+    }
+
+    void clearBuffered() noexcept
     {
-        return m_weak;
+        m_weak &= ~Buffered;
     }
+
+    // Frees the memory of separately stored content once the last strong reference is gone.
+    // The content must already be destructed.
+    void deallocateContent() noexcept
+    {
+        if (hasCustomDeallocation()) {
+            deallocator()(this, RcDeallocation::Content);
+        }
+    }
+
+// Blocks with custom deallocation sit at an offset in their allocation (after the deallocate function),
+// blocks without it are allocated with new. When a block is inlined into the same function as its
+// allocation, GCC can not see that the flag in the weak count keeps the two apart: it warns that the
+// delete below could free a pointer with a non-zero offset, or that deallocator() reads in front of a
+// block allocated with new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfree-nonheap-object"
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+    // Frees the memory of the control block once the last weak reference is gone.
+    // The content must already be destructed.
+    void deallocate() noexcept
+    {
+        if (isBuffered()) {
+            RcRootBuffer::forget(this);
+        }
+        if (hasCustomDeallocation()) {
+            deallocator()(this, RcDeallocation::ControlBlock);
+        } else {
+            ::operator delete(static_cast<void *>(this));
+        }
+    }
+
+protected:
+    RcDeallocateFunction deallocator() const noexcept
+    {
+        RcDeallocateFunction deallocator;
+        std::memcpy(&deallocator, reinterpret_cast<const unsigned char *>(this) - sizeof(deallocator), sizeof(deallocator));
+        return deallocator;
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
 };
 
-template<typename T>
-class RcValue : public RcControlBlock
+// Tag to create an RcValue without constructing its content.
+// The content must then be constructed in place before the first strong reference is created.
+struct RcUninitialized {
+};
+
+// The control block together with the value.
+//
+// If RcSeparateContent<T> is true, the value is not stored inline, but in its own allocation.
+// Such values are always created by RcAllocatedValue, which frees the content memory as well.
+template<typename T, typename Counter>
+class RcValue : public RcControlBlock<Counter>
 {
     struct Empty {
     };
@@ -59,56 +253,680 @@ class RcValue : public RcControlBlock
         {
         }
 
+        RcContent(RcUninitialized)
+            : empty()
+        {
+        }
+
         ~RcContent() { }
 
         T value;
         Empty empty;
-    } m_content;
+    };
 
 public:
+    static constexpr bool SeparateContent = RcSeparateContent<T>::value;
+
+    // Inline values are constructed from args, separately stored values only take the
+    // pointer to their (not yet constructed) content.
     template<typename... Args>
     RcValue(Args &&...args)
-        : RcControlBlock(), m_content(std::forward<Args>(args)...)
+        : RcControlBlock<Counter>(), m_content(std::forward<Args>(args)...)
     {
     }
 
-    virtual ~RcValue() = default;
-
     T &content() noexcept
     {
-        return m_content.value;
+        if constexpr (SeparateContent) {
+            return *m_content;
+        } else {
+            return m_content.value;
+        }
     }
 
     void destructContent()
     {
-        m_content.value.~T();
+        content().~T();
+        if constexpr (SeparateContent) {
+            this->deallocateContent();
+        }
+    }
+
+    // Like RcControlBlock::deallocate, but uses the known size for blocks allocated with new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// see RcControlBlock::deallocate
+#pragma GCC diagnostic ignored "-Wfree-nonheap-object"
+#endif
+    void deallocate() noexcept
+    {
+        if (this->hasCustomDeallocation()) {
+            RcControlBlock<Counter>::deallocate();
+        } else {
+            if (this->isBuffered()) {
+                RcRootBuffer::forget(static_cast<RcControlBlock<Counter> *>(this));
+            }
+            delete this;
+        }
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+private:
+    std::conditional_t<SeparateContent, T *, RcContent> m_content;
+};
+
+// Creates and frees RcValues whose memory is managed by an allocator instead of new/delete.
+//
+// The allocation is laid out as [allocator][deallocate function][RcValue<T, Counter>]. The allocator is only
+// stored if it has state, stateless allocators are default constructed again when the block is freed.
+// Separately stored content is allocated with the same allocator.
+template<typename T, typename Counter, typename Allocator>
+class RcAllocatedValue
+{
+    static constexpr std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr bool StoresAllocator = !(std::is_empty_v<Allocator> && std::is_default_constructible_v<Allocator>);
+    static constexpr std::size_t AllocatorSize = StoresAllocator ? sizeof(Allocator) : 0;
+    static constexpr std::size_t Alignment = std::max({ alignof(RcValue<T, Counter>), alignof(RcDeallocateFunction), alignof(Allocator) });
+
+    static constexpr std::size_t ValueOffset = alignUp(AllocatorSize + sizeof(RcDeallocateFunction), Alignment);
+    static constexpr std::size_t DeallocatorOffset = ValueOffset - sizeof(RcDeallocateFunction);
+    static constexpr std::size_t AllocatorOffset = (DeallocatorOffset - AllocatorSize) / alignof(Allocator) * alignof(Allocator);
+
+public:
+    struct alignas(Alignment) Block {
+        unsigned char bytes[ValueOffset + sizeof(RcValue<T, Counter>)];
+    };
+
+    using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+    using BlockTraits = std::allocator_traits<BlockAllocator>;
+    using ContentAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::remove_cv_t<T>>;
+    using ContentTraits = std::allocator_traits<ContentAllocator>;
+
+    // Allocates a block and constructs the content from args.
+    // The returned value has custom deallocation set, but no references yet.
+    template<typename... Args>
+    static RcValue<T, Counter> *create(const Allocator &allocator, Args &&...args)
+    {
+        auto *value = createUninitialized(allocator);
+        try {
+            // Construct through the allocator, so allocators like std::pmr::polymorphic_allocator
+            // can pass themselves on to allocator-aware content types.
+            ContentAllocator contentAllocator(allocator);
+            ContentTraits::construct(contentAllocator, const_cast<std::remove_cv_t<T> *>(&value->content()), std::forward<Args>(args)...);
+        } catch (...) {
+            value->deallocateContent();
+            deallocate(value, RcDeallocation::ControlBlock);
+            throw;
+        }
+        return value;
+    }
+
+    // Like create, but the content is not constructed.
+    static RcValue<T, Counter> *createUninitialized(const Allocator &allocator)
+    {
+        BlockAllocator blockAllocator(allocator);
+        Block *block = BlockTraits::allocate(blockAllocator, 1);
+        auto *bytes = reinterpret_cast<unsigned char *>(block);
+
+        RcValue<T, Counter> *value = nullptr;
+        if constexpr (RcValue<T, Counter>::SeparateContent) {
+            ContentAllocator contentAllocator(allocator);
+            T *content = nullptr;
+            try {
+                content = ContentTraits::allocate(contentAllocator, 1);
+            } catch (...) {
+                BlockTraits::deallocate(blockAllocator, block, 1);
+                throw;
+            }
+            value = ::new (static_cast<void *>(bytes + ValueOffset)) RcValue<T, Counter>(content);
+        } else {
+            value = ::new (static_cast<void *>(bytes + ValueOffset)) RcValue<T, Counter>(RcUninitialized{});
+        }
+
+        if constexpr (StoresAllocator) {
+            ::new (static_cast<void *>(bytes + AllocatorOffset)) Allocator(allocator);
+        }
+        ::new (static_cast<void *>(bytes + DeallocatorOffset)) RcDeallocateFunction(&RcAllocatedValue::deallocate);
+        value->setCustomDeallocation();
+
+        return value;
+    }
+
+    static void deallocate(void *controlBlock, RcDeallocation what) noexcept
+    {
+        auto *value = static_cast<RcValue<T, Counter> *>(static_cast<RcControlBlock<Counter> *>(controlBlock));
+        auto *bytes = reinterpret_cast<unsigned char *>(value) - ValueOffset;
+
+        if (what == RcDeallocation::Content) {
+            if constexpr (RcValue<T, Counter>::SeparateContent) {
+                ContentAllocator contentAllocator(storedAllocator(bytes));
+                ContentTraits::deallocate(contentAllocator, const_cast<std::remove_cv_t<T> *>(&value->content()), 1);
+            }
+            return;
+        }
+
+        BlockAllocator blockAllocator(takeAllocator(bytes));
+        value->~RcValue();
+        BlockTraits::deallocate(blockAllocator, reinterpret_cast<Block *>(bytes), 1);
+    }
+
+private:
+    static Allocator storedAllocator(unsigned char *bytes) noexcept
+    {
+        if constexpr (StoresAllocator) {
+            return *std::launder(reinterpret_cast<Allocator *>(bytes + AllocatorOffset));
+        } else {
+            return Allocator();
+        }
+    }
+
+    static Allocator takeAllocator(unsigned char *bytes) noexcept
+    {
+        if constexpr (StoresAllocator) {
+            auto *stored = std::launder(reinterpret_cast<Allocator *>(bytes + AllocatorOffset));
+            Allocator allocator(std::move(*stored));
+            stored->~Allocator();
+            return allocator;
+        } else {
+            return Allocator();
+        }
     }
 };
 
 } // namespace
 
-// forward declaration necessary for friend declarations
+// A scoped bump allocator for request-scoped object graphs.
+//
+// While an RcArena is alive, make_rc (and therefore make_prc) on the same thread allocates
+// out of the arena's memory instead of calling new. Freeing such a control block is a no-op;
+// the memory of all values is released at once when the arena is destroyed.
+// All values created in the arena must therefore be destroyed before the arena
+// (including their weak references), which is asserted in debug builds.
+//
+// Arenas can be nested, the innermost one is used. They must be destroyed in reverse order of
+// their creation.
+class RcArena
+{
+    struct Chunk {
+        Chunk *next;
+        std::size_t size;
+    };
+
+public:
+    explicit RcArena(std::size_t chunkSize = 64 * 1024)
+        : m_previous(s_current), m_chunkSize(chunkSize)
+    {
+        s_current = this;
+    }
+
+    RcArena(const RcArena &) = delete;
+    RcArena &operator=(const RcArena &) = delete;
+
+    ~RcArena()
+    {
+        assert(s_current == this && "RcArenas must be destroyed in reverse order of their creation");
+        assert(m_live == 0 && "All values allocated in an RcArena must be destroyed before the arena");
+        s_current = m_previous;
+
+        while (m_chunks) {
+            Chunk *next = m_chunks->next;
+            std::free(m_chunks);
+            m_chunks = next;
+        }
+    }
+
+    // The innermost arena of the current thread, if any.
+    static RcArena *current() noexcept
+    {
+        return s_current;
+    }
+
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        auto aligned = (m_position + alignment - 1) & ~(alignment - 1);
+        if (!m_chunks || aligned + size > m_end) {
+            addChunk(size + alignment);
+            aligned = (m_position + alignment - 1) & ~(alignment - 1);
+        }
+        m_position = aligned + size;
+#ifndef NDEBUG
+        m_live++;
+#endif
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    void deallocate(void *) noexcept
+    {
+#ifndef NDEBUG
+        m_live--;
+#endif
+    }
+
+private:
+    void addChunk(std::size_t minimumSize)
+    {
+        const auto size = std::max(m_chunkSize, minimumSize + sizeof(Chunk));
+        auto *chunk = static_cast<Chunk *>(std::malloc(size));
+        if (!chunk) {
+            throw std::bad_alloc();
+        }
+        chunk->next = m_chunks;
+        chunk->size = size;
+        m_chunks = chunk;
+
+        m_position = reinterpret_cast<std::uintptr_t>(chunk + 1);
+        m_end = reinterpret_cast<std::uintptr_t>(chunk) + size;
+        // every further chunk is twice as large, so big graphs need few chunks
+        m_chunkSize *= 2;
+    }
+
+    RcArena *m_previous;
+    std::size_t m_chunkSize;
+    Chunk *m_chunks = nullptr;
+    std::uintptr_t m_position = 0;
+    std::uintptr_t m_end = 0;
+#ifndef NDEBUG
+    std::size_t m_live = 0;
+#endif
+
+    static inline thread_local RcArena *s_current = nullptr;
+};
+
+// Allocates from an RcArena, deallocation is a no-op.
 template<typename T>
+class RcArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit RcArenaAllocator(RcArena &arena) noexcept
+        : m_arena(&arena)
+    {
+    }
+
+    template<typename U>
+    RcArenaAllocator(const RcArenaAllocator<U> &other) noexcept
+        : m_arena(other.arena())
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t) noexcept
+    {
+        m_arena->deallocate(pointer);
+    }
+
+    RcArena *arena() const noexcept
+    {
+        return m_arena;
+    }
+
+    template<typename U>
+    bool operator==(const RcArenaAllocator<U> &other) const noexcept
+    {
+        return m_arena == other.arena();
+    }
+
+    template<typename U>
+    bool operator!=(const RcArenaAllocator<U> &other) const noexcept
+    {
+        return m_arena != other.arena();
+    }
+
+private:
+    RcArena *m_arena;
+};
+
+// The values of the current thread whose last strong reference is gone, but which are not destroyed yet.
+//
+// While an RcDeferredDrops is alive, releasing the last Rc to a value only appends it to this queue.
+// drain_drops then destroys the queued values in slices, so dropping a large graph does not stall
+// the thread at once. Values released by the destructors of queued values are queued as well.
+// Weak references to a queued value can no longer be locked.
+//
+// The queue also bounds the recursion when a value is destroyed: ~Node releases its Rc<Node> fields,
+// which destroys the next node and so on, so dropping a long list would overflow the stack.
+// Values released at a nesting depth of MaxDropDepth are queued instead, and the outermost
+// release destroys them after its own value. Only such deep graphs see a different destruction order.
+class RcDropQueue
+{
+public:
+    // Destroys the content of a released value and frees its memory if no weak reference is left.
+    // content is only used by owners that refer to the content through a base class, like Prc.
+    using DropFunction = void (*)(void *value, void *content) noexcept;
+
+private:
+    struct Entry {
+        void *value;
+        void *content;
+        DropFunction drop;
+    };
+
+    // Created on the first use of the queue, destroyed with the other thread-local objects of the thread.
+    struct Queue {
+        // values must not outlive their thread
+        ~Queue();
+
+        std::vector<Entry> pending;
+    };
+
+    // Trivially destructible, so it stays usable while the thread-local and static objects of the thread
+    // are destroyed, e.g. to release an Rc held by a static object.
+    struct State {
+        Queue *queue = nullptr;
+        // the queue was destroyed, values are destroyed right away from now on
+        bool finished = false;
+        std::size_t deferring = 0;
+        std::size_t depth = 0;
+    };
+
+    static constexpr std::size_t ClockInterval = 16;
+    static constexpr std::size_t MaxDropDepth = 16;
+
+public:
+    // Whether the final release of an Rc on the current thread is deferred.
+    static bool deferring() noexcept
+    {
+        const auto &current = state();
+        return current.deferring > 0 && !current.finished;
+    }
+
+    // Destroys a value whose last strong reference is gone, or queues it if drops are deferred or
+    // the value is released by the destructor of a deeply nested value.
+    // Once the queue of the thread is destroyed, values are always destroyed right away.
+    //
+    // Value is an RcValue (also of an array or with trailing elements), whose content is destroyed
+    // by destructContent().
+    template<typename Value>
+    static void release(Value &value) noexcept
+    {
+        release(&value, nullptr, &drop<Value>);
+    }
+
+    // Like release, but destroys the content through a pointer to T, see Prc.
+    template<typename T, typename Counter>
+    static void release(RcControlBlock<Counter> &controlBlock, T *content) noexcept
+    {
+        release(&controlBlock, const_cast<std::remove_cv_t<T> *>(content), &dropContent<std::remove_cv_t<T>, Counter>);
+    }
+
+    // Like release, but the value is destroyed by drop(value, content).
+    static void release(void *value, void *content, DropFunction drop) noexcept
+    {
+        auto &current = state();
+        if (current.finished) {
+            drop(value, content);
+            return;
+        }
+        if (current.deferring > 0 || current.depth >= MaxDropDepth) {
+            push({ value, content, drop });
+            return;
+        }
+
+        current.depth++;
+        drop(value, content);
+        if (current.depth == 1 && current.queue && !current.queue->pending.empty()) {
+            // trampoline: destroy the values queued by the nested releases, one level at a time
+            auto &pending = current.queue->pending;
+            while (!pending.empty()) {
+                dropNext(pending);
+            }
+            std::vector<Entry>().swap(pending);
+        }
+        current.depth--;
+    }
+
+    // Destroys at most maxValues queued values and returns how many were destroyed.
+    static std::size_t drain(std::size_t maxValues) noexcept
+    {
+        auto *current = state().queue;
+        std::size_t dropped = 0;
+        for (; current && dropped < maxValues && !current->pending.empty(); ++dropped) {
+            dropNext(current->pending);
+        }
+        return dropped;
+    }
+
+    // Destroys queued values until the queue is empty or the time slice is used up.
+    // The clock is only checked every ClockInterval values, so at least that many values are
+    // destroyed if there are as many. Returns how many were destroyed.
+    static std::size_t drain(std::chrono::nanoseconds timeSlice) noexcept
+    {
+        auto *current = state().queue;
+        if (!current) {
+            return 0;
+        }
+        auto &pending = current->pending;
+        const auto end = std::chrono::steady_clock::now() + timeSlice;
+        std::size_t dropped = 0;
+        while (!pending.empty()) {
+            dropNext(pending);
+            // reading the clock costs about as much as destroying a small value
+            if (++dropped % ClockInterval == 0 && std::chrono::steady_clock::now() >= end) {
+                break;
+            }
+        }
+        return dropped;
+    }
+
+    static std::size_t size() noexcept
+    {
+        const auto *current = state().queue;
+        return current ? current->pending.size() : 0;
+    }
+
+private:
+    friend class RcDeferredDrops;
+
+    // Queues a value whose last strong reference is gone.
+    static void push(const Entry &entry) noexcept
+    {
+        try {
+            if (auto *current = queue()) {
+                current->pending.push_back(entry);
+                return;
+            }
+        } catch (...) {
+        }
+        // without a queue (or memory for it) the value is destroyed right away
+        entry.drop(entry.value, entry.content);
+    }
+
+    template<typename Value>
+    static void drop(void *pointer, void *) noexcept
+    {
+        auto *value = static_cast<Value *>(pointer);
+        value->destructContent();
+        if (value->decrementWeak() == 0) {
+            value->deallocate();
+        }
+    }
+
+    template<typename T, typename Counter>
+    static void dropContent(void *pointer, void *content) noexcept
+    {
+        auto *controlBlock = static_cast<RcControlBlock<Counter> *>(pointer);
+        static_cast<T *>(content)->~T();
+        controlBlock->deallocateContent();
+        if (controlBlock->decrementWeak() == 0) {
+            controlBlock->deallocate();
+        }
+    }
+
+    static void dropNext(std::vector<Entry> &pending) noexcept
+    {
+        // pop first, the destructor may queue further values
+        const auto entry = pending.back();
+        pending.pop_back();
+        entry.drop(entry.value, entry.content);
+    }
+
+    static void drainAll() noexcept
+    {
+        auto *current = state().queue;
+        if (!current) {
+            return;
+        }
+        while (!current->pending.empty()) {
+            dropNext(current->pending);
+        }
+        // the queue may have grown large, don't keep its memory around
+        std::vector<Entry>().swap(current->pending);
+    }
+
+    static void beginDeferring() noexcept
+    {
+        state().deferring++;
+    }
+
+    static void endDeferring() noexcept
+    {
+        if (--state().deferring == 0) {
+            drainAll();
+        }
+    }
+
+    static State &state() noexcept
+    {
+        static thread_local State state;
+        return state;
+    }
+
+    // The queue of the current thread, nullptr once it was destroyed at the exit of the thread.
+    static Queue *queue() noexcept
+    {
+        auto &current = state();
+        if (!current.queue && !current.finished) {
+            static thread_local Queue queue;
+            current.queue = &queue;
+        }
+        return current.queue;
+    }
+};
+
+inline RcDropQueue::Queue::~Queue()
+{
+    drainAll();
+    auto &current = state();
+    current.queue = nullptr;
+    current.finished = true;
+}
+
+// Defers the destruction of values released on the current thread while it is alive, see RcDropQueue.
+// Scopes can be nested. When the last one is destroyed, all values that are still queued are destroyed.
+class RcDeferredDrops
+{
+public:
+    RcDeferredDrops() noexcept
+    {
+        RcDropQueue::beginDeferring();
+    }
+
+    RcDeferredDrops(const RcDeferredDrops &) = delete;
+    RcDeferredDrops &operator=(const RcDeferredDrops &) = delete;
+
+    ~RcDeferredDrops()
+    {
+        RcDropQueue::endDeferring();
+    }
+};
+
+// Destroys at most maxValues values queued by RcDeferredDrops, returns how many were destroyed.
+inline std::size_t drain_drops(std::size_t maxValues) noexcept
+{
+    return RcDropQueue::drain(maxValues);
+}
+
+// Destroys values queued by RcDeferredDrops for about the given time slice, returns how many were destroyed.
+inline std::size_t drain_drops(std::chrono::nanoseconds timeSlice) noexcept
+{
+    return RcDropQueue::drain(timeSlice);
+}
+
+// The number of values queued by RcDeferredDrops on the current thread.
+inline std::size_t pending_drops() noexcept
+{
+    return RcDropQueue::size();
+}
+
+// forward declarations necessary for friend declarations
+template<typename T, typename Counter = std::size_t>
 class Prc;
 
+template<typename T, typename Counter = std::size_t>
+class Weak;
+
+template<typename T, typename Counter = std::size_t>
+class enable_rc_from_this;
+
+template<typename T, typename Counter = std::size_t>
+class UniqueRc;
+
+template<typename T, typename Counter = std::size_t>
+class RcUninit;
+
+class RcTracer;
+
+// Whether T takes part in cycle collection, see rcpp/cycles.h.
+// Types opt in by providing a member function void trace(RcTracer &) const.
+template<typename T, typename = void>
+struct RcTraceable : std::false_type {
+};
+
 template<typename T>
+struct RcTraceable<T, std::void_t<decltype(std::declval<const T &>().trace(std::declval<RcTracer &>()))>> : std::true_type {
+};
+
+// Buffers a value whose strong count was decremented to a non-zero value as a possible root of a cycle.
+// Defined in rcpp/cycles.h, which must be included by traceable types.
+template<typename T, typename Counter>
+void rcPossibleRoot(RcValue<T, Counter> &value);
+
+template<typename T, typename Counter = std::size_t>
 class Rc
 {
 public:
-    template<typename U, typename... Args>
-    friend Rc<U> make_rc(Args &&...args);
-
-    template<typename U>
+    template<typename U, typename C>
     friend class Weak;
 
-    template<typename U>
+    template<typename U, typename C>
     friend class Prc;
 
-    template<typename Derived, typename Base>
-    friend Rc<Derived> dynamic_base_pointer_cast(const Prc<Base> &);
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, C>> dynamic_base_pointer_cast(const Prc<Base, C> &);
+
+    template<typename Derived, typename Base, typename C>
+    friend std::enable_if_t<std::is_polymorphic_v<Base>, Rc<Derived, C>> dynamic_base_pointer_cast(Prc<Base, C> &&);
+
+    template<typename U, typename C>
+    friend U &make_mut(Rc<U, C> &);
+
+    template<typename U, typename C>
+    friend std::optional<U> try_unwrap(Rc<U, C> &&);
 
-    template<typename Derived, typename Base>
-    friend Rc<Derived> dynamic_base_pointer_cast(Prc<Base> &&);
+    template<typename U, typename C>
+    friend U *get_mut(Rc<U, C> &) noexcept;
+
+    template<typename U, typename C>
+    friend class UniqueRc;
+
+    template<typename U, typename C>
+    friend class RcUninit;
+
+    friend class RcTracer;
+
+    template<typename U, typename C, typename F>
+    friend Rc<U, C> new_cyclic(F &&);
 
     ~Rc()
     {
@@ -120,13 +938,13 @@ public:
     {
     }
 
-    Rc(Rc<T> &&other) noexcept
+    Rc(Rc &&other) noexcept
         : Rc()
     {
         swap(*this, other);
     }
 
-    Rc(const Rc<T> &other) noexcept
+    Rc(const Rc &other) noexcept
         : m_value(other.m_value)
     {
         if (m_value) {
@@ -134,30 +952,107 @@ public:
         }
     }
 
-    friend void swap(Rc<T> &first, Rc<T> &second) noexcept
+    friend void swap(Rc &first, Rc &second) noexcept
     {
         using std::swap;
 
         swap(first.m_value, second.m_value);
     }
 
-    Rc &operator=(Rc<T> other) noexcept
+    Rc &operator=(Rc other) noexcept
     {
         swap(*this, other);
         return *this;
     }
 
+    // Creates a new value, see make_rc.
+    // Use this instead of make_rc to create an Rc with a different Counter type.
+    template<typename... Args>
+    static Rc make(Args &&...args)
+    {
+        if (auto *arena = RcArena::current()) {
+            return allocate(RcArenaAllocator<T>(*arena), std::forward<Args>(args)...);
+        }
+        if constexpr (AllocatesWithNew) {
+            return makeWithNew(std::forward<Args>(args)...);
+        } else {
+            // Type-erased owners like Prc free the block without knowing its alignment or layout,
+            // so over-aligned and separately stored values are allocated with custom deallocation.
+            return allocate(std::allocator<T>(), std::forward<Args>(args)...);
+        }
+    }
+
+    // Creates a new value with the given allocator, see allocate_rc.
+    template<typename Allocator, typename... Args>
+    static Rc allocate(const Allocator &allocator, Args &&...args)
+    {
+        if constexpr (AllocatesWithNew && IsStdAllocator<Allocator>::value) {
+            // std::allocator allocates with operator new as well, so the block needs no deallocate function
+            return makeWithNew(std::forward<Args>(args)...);
+        } else {
+            auto *value = RcAllocatedValue<T, Counter, Allocator>::create(allocator, std::forward<Args>(args)...);
+            value->incrementWeak();
+
+            return adopt(*value);
+        }
+    }
+
+    // Creates a new value that is default-initialized instead of value-initialized, see make_rc_for_overwrite.
+    static Rc make_for_overwrite()
+    {
+        auto *value = makeUninitialized();
+        try {
+            ::new (static_cast<void *>(&value->content())) T;
+        } catch (...) {
+            releaseUninitialized(*value);
+            throw;
+        }
+        return adopt(*value);
+    }
+
+    // Replaces rc with an Rc to a new value constructed from args, like rc = make_rc<T>(args...).
+    //
+    // If rc is the only reference to its value, the old value is destructed and the new one is
+    // constructed with placement new in the same memory, which saves a deallocation and an allocation.
+    // Otherwise the new value is created with make. As the old value may be destructed before the new
+    // one is constructed, args must not refer to the old value.
+    template<typename... Args>
+    static Rc reuse_or_make(Rc &&rc, Args &&...args)
+    {
+        if (!rc.isUnique()) {
+            Rc result = make(std::forward<Args>(args)...);
+            rc.reset();
+            return result;
+        }
+
+        Rc result(std::move(rc));
+        auto *value = result.m_value;
+        T *content = &value->content();
+        content->~T();
+        try {
+            ::new (static_cast<void *>(content)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            // the value is already destructed, only release the memory
+            result.m_value = nullptr;
+            value->decrementStrong();
+            value->deallocateContent();
+            if (value->decrementWeak() == 0) {
+                value->deallocate();
+            }
+            throw;
+        }
+        result.enableRcFromThis();
+        return result;
+    }
+
     void reset()
     {
         if (m_value) {
             if (m_value->decrementStrong() == 0) {
-                m_value->destructContent();
-
-                // all strong references destructed, remove the
-                // implicit weak reference
-                if (m_value->decrementWeak() == 0) {
-                    delete m_value;
-                }
+                RcDropQueue::release(*m_value);
+            } else if constexpr (RcTraceable<T>::value) {
+                // the remaining references might all be part of a cycle
+                rcPossibleRoot(*m_value);
             }
         }
         m_value = nullptr;
@@ -179,25 +1074,182 @@ public:
     }
 
 private:
-    RcValue<T> *m_value;
+    RcValue<T, Counter> *m_value;
+
+    // Whether values are allocated with plain new instead of with custom deallocation.
+    static constexpr bool AllocatesWithNew = !RcValue<T, Counter>::SeparateContent && alignof(RcValue<T, Counter>) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    template<typename Allocator>
+    struct IsStdAllocator : std::false_type {
+    };
+
+    template<typename U>
+    struct IsStdAllocator<std::allocator<U>> : std::true_type {
+    };
 
-    Rc(RcValue<T> &value)
+    Rc(RcValue<T, Counter> &value)
         : m_value(&value)
     {
         m_value->incrementStrong();
     }
+
+    template<typename... Args>
+    static Rc makeWithNew(Args &&...args)
+    {
+        auto *value = new RcValue<T, Counter>(std::forward<Args>(args)...);
+        // we add one implicit weak reference for all strong references,
+        // so the weak destructor doesn't run the control block destructor
+        // if another strong pointer exists
+        value->incrementWeak();
+
+        return adopt(*value);
+    }
+
+    // Allocates a value like make, but does not construct its content.
+    // The value only has the implicit weak reference.
+    static RcValue<T, Counter> *makeUninitialized()
+    {
+        RcValue<T, Counter> *value = nullptr;
+        if (auto *arena = RcArena::current()) {
+            value = RcAllocatedValue<T, Counter, RcArenaAllocator<T>>::createUninitialized(RcArenaAllocator<T>(*arena));
+        } else if constexpr (AllocatesWithNew) {
+            value = new RcValue<T, Counter>(RcUninitialized{});
+        } else {
+            value = RcAllocatedValue<T, Counter, std::allocator<T>>::createUninitialized(std::allocator<T>());
+        }
+        value->incrementWeak();
+        return value;
+    }
+
+    // Frees a value from makeUninitialized whose content was never constructed.
+    static void releaseUninitialized(RcValue<T, Counter> &value) noexcept
+    {
+        value.deallocateContent();
+        if (value.decrementWeak() == 0) {
+            value.deallocate();
+        }
+    }
+
+    // Takes the first strong reference to a newly created value.
+    static Rc adopt(RcValue<T, Counter> &value)
+    {
+        Rc rc(value);
+        rc.enableRcFromThis();
+        return rc;
+    }
+
+    void enableRcFromThis()
+    {
+        if constexpr (std::is_base_of_v<enable_rc_from_this<T, Counter>, T>) {
+            (*this)->enable_rc_from_this<T, Counter>::m_weakThis = *this;
+        }
+    }
+
+    // Whether this is the only reference to the value.
+    // The Weak of enable_rc_from_this does not count, it is owned by the value itself.
+    bool isUnique() const noexcept
+    {
+        constexpr Counter OwnWeak = std::is_base_of_v<enable_rc_from_this<T, Counter>, T> ? 2 : 1;
+        return m_value && m_value->strong() == 1 && m_value->weak() == OwnWeak;
+    }
 };
 
 template<typename T, typename... Args>
 Rc<T> make_rc(Args &&...args)
 {
-    auto *value = new RcValue<T>(std::forward<Args>(args)...);
-    // we add one implicit weak reference for all strong references,
-    // so the weak destructor doesn't run the control block destructor
-    // if another strong pointer exists
-    value->incrementWeak();
+    return Rc<T>::make(std::forward<Args>(args)...);
+}
+
+// Like make_rc, but the value is default-initialized (T instead of T()), so e.g. the elements of a
+// std::array<float, N> are left uninitialized instead of being zeroed. Use it for buffers that are
+// overwritten right away anyway.
+template<typename T>
+Rc<T> make_rc_for_overwrite()
+{
+    return Rc<T>::make_for_overwrite();
+}
+
+// Like make_rc, but the control block and the value are allocated with the given allocator.
+// The allocator is stored in front of the control block and used to free the memory once the last
+// weak reference is gone. Stateless allocators are not stored at all, but the allocation still grows by
+// the pointer to the function that frees it (8 bytes on 64-bit, possibly more to keep the value aligned).
+// Only std::allocator is special-cased: it allocates with new like make_rc and adds nothing.
+template<typename T, typename Allocator, typename... Args>
+Rc<T> allocate_rc(const Allocator &allocator, Args &&...args)
+{
+    return Rc<T>::allocate(allocator, std::forward<Args>(args)...);
+}
+
+// Returns a mutable reference to the value of rc (copy-on-write).
+//
+// If rc is the only reference to its value, the value is returned in place.
+// If other Rcs share the value, rc is changed to refer to a new copy of the value first.
+// If only Weaks refer to the value as well, the value is moved into a new allocation instead,
+// the Weaks can then no longer be locked.
+template<typename T, typename Counter>
+T &make_mut(Rc<T, Counter> &rc)
+{
+    assert(rc && "make_mut requires a non-empty Rc");
+
+    if (rc.m_value->strong() != 1) {
+        rc = Rc<T, Counter>::make(std::as_const(*rc));
+    } else if (!rc.isUnique()) {
+        // releasing the old value disassociates the weak references
+        rc = Rc<T, Counter>::make(std::move(*rc));
+    }
+    return *rc;
+}
+
+// Moves the value out of rc if rc is its only strong reference.
+//
+// On success rc is empty afterwards and Weaks to the value can no longer be locked.
+// Otherwise an empty optional is returned and rc is left unchanged.
+template<typename T, typename Counter>
+std::optional<T> try_unwrap(Rc<T, Counter> &&rc)
+{
+    if (!rc || rc.m_value->strong() != 1) {
+        return std::nullopt;
+    }
+    std::optional<T> result(std::move(*rc));
+    // destructs the moved-from value and disassociates the weak references
+    rc.reset();
+    return result;
+}
+
+// Like try_unwrap, but rc is always empty afterwards.
+// The value is returned if rc was its last strong reference.
+template<typename T, typename Counter>
+std::optional<T> into_inner(Rc<T, Counter> &&rc)
+{
+    auto result = try_unwrap(std::move(rc));
+    rc.reset();
+    return result;
+}
+
+// Moves the value out of rc if it is the only strong reference, otherwise returns a copy.
+// rc is empty afterwards.
+template<typename T, typename Counter>
+T unwrap_or_clone(Rc<T, Counter> &&rc)
+{
+    assert(rc && "unwrap_or_clone requires a non-empty Rc");
+
+    if (auto result = try_unwrap(std::move(rc))) {
+        return std::move(*result);
+    }
+    T copy(std::as_const(*rc));
+    rc.reset();
+    return copy;
+}
 
-    return Rc<T>(*value);
+// Returns a pointer to the value of rc that can be used to modify it,
+// if rc is the only reference to the value (strong or weak). Returns nullptr otherwise.
+template<typename T, typename Counter>
+T *get_mut(Rc<T, Counter> &rc) noexcept
+{
+    if (rc.isUnique()) {
+        return &*rc;
+    }
+    return nullptr;
 }
 
 } // namespace Rcpp
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <rcpp/rc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+namespace Rcpp {
+
+namespace {
+
+// The number of elements that follow a control block in its allocation, together with their alignment.
+//
+// Both are packed into a single word: the alignment only takes the upper 8 bits. The elements are not
+// pointed to, they start at the first suitably aligned address after the Value that holds this size.
+class RcTrailingSize
+{
+    static constexpr unsigned AlignmentShift = std::numeric_limits<std::size_t>::digits - 8;
+
+public:
+    static constexpr std::size_t MaxSize = (std::size_t(1) << AlignmentShift) - 1;
+
+    RcTrailingSize(std::size_t size, std::size_t alignment) noexcept
+        : m_packed(size)
+    {
+        std::size_t log2 = 0;
+        while ((std::size_t(1) << log2) < alignment) {
+            ++log2;
+        }
+        m_packed |= log2 << AlignmentShift;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_packed & MaxSize;
+    }
+
+    // The elements that follow value in its allocation.
+    template<typename T, typename Value>
+    T *elements(const Value *value) const noexcept
+    {
+        const std::uintptr_t alignment = std::uintptr_t(1) << (m_packed >> AlignmentShift);
+        const auto end = reinterpret_cast<std::uintptr_t>(value) + sizeof(Value);
+        return reinterpret_cast<T *>((end + alignment - 1) & ~(alignment - 1));
+    }
+
+private:
+    std::size_t m_packed;
+};
+
+// The control block of an Rc<T[]>, followed by the elements in the same allocation.
+//
+// The block is always freed by the RcDeallocateFunction in front of it, which knows the
+// alignment of the elements and recomputes the size of the allocation from the length.
+template<typename T, typename Counter>
+class RcValue<T[], Counter> : public RcControlBlock<Counter>
+{
+public:
+    RcValue(std::size_t size, std::size_t alignment) noexcept
+        : m_size(size, alignment)
+    {
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_size.size();
+    }
+
+    T *data() const noexcept
+    {
+        return m_size.template elements<T>(this);
+    }
+
+    void destructContent() noexcept
+    {
+        std::destroy_n(data(), size());
+    }
+
+    // array blocks always have custom deallocation
+    void deallocate() noexcept
+    {
+        this->deallocator()(this, RcDeallocation::ControlBlock);
+    }
+
+private:
+    RcTrailingSize m_size;
+};
+
+// Allocates and frees the memory of a Value (e.g. RcValue<T[], Counter>) that is followed
+// by elements of type T, which are aligned to at least Alignment.
+//
+// The allocation is laid out as [deallocate function][Value][elements], the elements start at the first
+// address after the Value that is aligned to ElementAlignment, so the Value does not need to point to them.
+// Value must be constructible from (size, ElementAlignment, args...) and provide size().
+template<typename Value, typename T, typename Counter, std::size_t Alignment>
+class RcTrailingAllocation
+{
+    static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0, "The alignment of an Rc array must be a power of two");
+
+    static constexpr std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr std::size_t ElementAlignment = std::max(Alignment, alignof(T));
+    static constexpr std::size_t BlockAlignment = std::max({ ElementAlignment, alignof(Value), alignof(RcDeallocateFunction) });
+    static constexpr std::size_t ValueOffset = alignUp(sizeof(RcDeallocateFunction), alignof(Value));
+    static constexpr std::size_t DeallocatorOffset = ValueOffset - sizeof(RcDeallocateFunction);
+    static constexpr std::size_t ElementsOffset = alignUp(ValueOffset + sizeof(Value), ElementAlignment);
+
+    static std::size_t allocationSize(std::size_t size)
+    {
+        if (size > RcTrailingSize::MaxSize || size > (std::numeric_limits<std::size_t>::max() - ElementsOffset) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return ElementsOffset + size * sizeof(T);
+    }
+
+public:
+    // Allocates memory for size elements, which are not constructed yet, and constructs the Value from args.
+    // The returned value has custom deallocation set, but no references yet.
+    template<typename... Args>
+    static Value *create(std::size_t size, Args &&...args)
+    {
+        const auto bytes = allocationSize(size);
+        unsigned char *block;
+        if constexpr (BlockAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            block = static_cast<unsigned char *>(::operator new(bytes, std::align_val_t(BlockAlignment)));
+        } else {
+            block = static_cast<unsigned char *>(::operator new(bytes));
+        }
+
+        Value *value = nullptr;
+        try {
+            value = ::new (static_cast<void *>(block + ValueOffset)) Value(size, ElementAlignment, std::forward<Args>(args)...);
+        } catch (...) {
+            free(block, bytes);
+            throw;
+        }
+        ::new (static_cast<void *>(block + DeallocatorOffset)) RcDeallocateFunction(&RcTrailingAllocation::deallocate);
+        value->setCustomDeallocation();
+        assert(reinterpret_cast<unsigned char *>(value->data()) == block + ElementsOffset);
+        return value;
+    }
+
+    static void deallocate(void *controlBlock, RcDeallocation what) noexcept
+    {
+        if (what == RcDeallocation::Content) {
+            return;
+        }
+        auto *value = static_cast<Value *>(static_cast<RcControlBlock<Counter> *>(controlBlock));
+        auto *block = reinterpret_cast<unsigned char *>(value) - ValueOffset;
+        const auto bytes = ElementsOffset + value->size() * sizeof(T);
+
+        value->~Value();
+        free(block, bytes);
+    }
+
+private:
+    static void free(unsigned char *block, std::size_t bytes) noexcept
+    {
+        if constexpr (BlockAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(block, bytes, std::align_val_t(BlockAlignment));
+        } else {
+            ::operator delete(block, bytes);
+        }
+    }
+};
+
+} // namespace
+
+// A view of the elements of an Rc<T[]> or the trailing elements of an Rc<RcTrailing<Header, T>>,
+// like std::span in C++20. It does not keep the elements alive.
+template<typename T>
+class RcSpan
+{
+public:
+    using value_type = T;
+    using iterator = T *;
+
+    RcSpan(T *data, std::size_t size) noexcept
+        : m_data(data), m_size(size)
+    {
+    }
+
+    T *data() const noexcept
+    {
+        return m_data;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    T &operator[](std::size_t index) const noexcept
+    {
+        return m_data[index];
+    }
+
+    iterator begin() const noexcept
+    {
+        return m_data;
+    }
+
+    iterator end() const noexcept
+    {
+        return m_data + m_size;
+    }
+
+#if __cplusplus >= 202002L
+    operator std::span<T>() const noexcept
+    {
+        return std::span<T>(m_data, m_size);
+    }
+#endif
+
+private:
+    T *m_data;
+    std::size_t m_size;
+};
+
+// A reference counted array of a runtime length, created by make_rc_array.
+//
+// The length and the elements are stored in the same allocation as the reference counts,
+// so accessing an element does not need another indirection like Rc<std::vector<T>>.
+// Weak<T[]> refers to an Rc<T[]> like to any other Rc.
+template<typename T, typename Counter>
+class Rc<T[], Counter>
+{
+public:
+    template<typename U, typename C>
+    friend class Weak;
+
+    using value_type = T;
+    using iterator = T *;
+
+    ~Rc()
+    {
+        reset();
+    }
+
+    Rc() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    Rc(Rc &&other) noexcept
+        : Rc()
+    {
+        swap(*this, other);
+    }
+
+    Rc(const Rc &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    friend void swap(Rc &first, Rc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    Rc &operator=(Rc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    // Creates an array of size value-initialized elements, whose memory is aligned to at least Alignment.
+    template<std::size_t Alignment = alignof(T)>
+    static Rc make(std::size_t size)
+    {
+        return create<Alignment>(size, [](T *elements, std::size_t size) { std::uninitialized_value_construct_n(elements, size); });
+    }
+
+    // Creates an array of size copies of value.
+    template<std::size_t Alignment = alignof(T)>
+    static Rc make(std::size_t size, const T &value)
+    {
+        return create<Alignment>(size, [&value](T *elements, std::size_t size) { std::uninitialized_fill_n(elements, size, value); });
+    }
+
+    // Creates an array of size default-initialized elements, see make_rc_for_overwrite.
+    template<std::size_t Alignment = alignof(T)>
+    static Rc make_for_overwrite(std::size_t size)
+    {
+        return create<Alignment>(size, [](T *elements, std::size_t size) { std::uninitialized_default_construct_n(elements, size); });
+    }
+
+    // Creates an array with copies of the elements in [first, last).
+    template<std::size_t Alignment = alignof(T), typename ForwardIt>
+    static Rc from_range(ForwardIt first, ForwardIt last)
+    {
+        const auto size = static_cast<std::size_t>(std::distance(first, last));
+        return create<Alignment>(size, [first](T *elements, std::size_t size) { std::uninitialized_copy_n(first, size, elements); });
+    }
+
+    void reset()
+    {
+        if (m_value) {
+            if (m_value->decrementStrong() == 0) {
+                // destroys the elements and removes the implicit weak reference, see Rc<T>::reset
+                RcDropQueue::release(*m_value);
+            }
+        }
+        m_value = nullptr;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_value ? m_value->size() : 0;
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    T *data() const noexcept
+    {
+        return m_value ? m_value->data() : nullptr;
+    }
+
+    T &operator[](std::size_t index) const noexcept
+    {
+        return m_value->data()[index];
+    }
+
+    iterator begin() const noexcept
+    {
+        return data();
+    }
+
+    iterator end() const noexcept
+    {
+        return data() + size();
+    }
+
+    // A view of the elements, convertible to std::span<T> in C++20.
+    RcSpan<T> span() const noexcept
+    {
+        return RcSpan<T>(data(), size());
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    RcValue<T[], Counter> *m_value;
+
+    Rc(RcValue<T[], Counter> &value)
+        : m_value(&value)
+    {
+        m_value->incrementStrong();
+    }
+
+    template<std::size_t Alignment, typename Construct>
+    static Rc create(std::size_t size, Construct construct)
+    {
+        auto *value = RcTrailingAllocation<RcValue<T[], Counter>, T, Counter, Alignment>::create(size);
+        try {
+            construct(value->data(), size);
+        } catch (...) {
+            value->deallocate();
+            throw;
+        }
+        // the implicit weak reference of all strong references, see Rc<T>::make
+        value->incrementWeak();
+        return Rc(*value);
+    }
+};
+
+// Creates an Rc<T[]> of n value-initialized elements, aligned to at least Alignment
+// (e.g. 64 for SIMD loads).
+template<typename T, std::size_t Alignment = alignof(T)>
+Rc<T[]> make_rc_array(std::size_t n)
+{
+    return Rc<T[]>::template make<Alignment>(n);
+}
+
+// Creates an Rc<T[]> of n copies of value.
+template<typename T, std::size_t Alignment = alignof(T)>
+Rc<T[]> make_rc_array(std::size_t n, const T &value)
+{
+    return Rc<T[]>::template make<Alignment>(n, value);
+}
+
+// Creates an Rc<T[]> of n default-initialized elements.
+template<typename T, std::size_t Alignment = alignof(T)>
+Rc<T[]> make_rc_array_for_overwrite(std::size_t n)
+{
+    return Rc<T[]>::template make_for_overwrite<Alignment>(n);
+}
+
+// Creates an Rc<T[]> with copies of the elements of range.
+template<typename T, std::size_t Alignment = alignof(T), typename Range>
+Rc<T[]> make_rc_array_from(const Range &range)
+{
+    using std::begin;
+    using std::end;
+    return Rc<T[]>::template from_range<Alignment>(begin(range), end(range));
+}
+
+} // namespace Rcpp
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <rcpp/rc.h>
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace Rcpp {
+
+namespace {
+
+// The control block of an RcStrongOnly: just the strong count, followed by the value.
+template<typename T, typename Counter>
+class RcStrongValue
+{
+    static_assert(std::is_unsigned_v<Counter>, "The counter of an Rc must be an unsigned integer type");
+
+    Counter m_strong = 0;
+    T m_content;
+
+public:
+    template<typename... Args>
+    RcStrongValue(Args &&...args)
+        : m_content(std::forward<Args>(args)...)
+    {
+    }
+
+    Counter incrementStrong()
+    {
+        assert(m_strong != std::numeric_limits<Counter>::max() && "Too many strong references for the Rc counter type");
+        return ++m_strong;
+    }
+
+    Counter decrementStrong()
+    {
+        return --m_strong;
+    }
+
+    Counter strong()
+    {
+        return m_strong;
+    }
+
+    T &content() noexcept
+    {
+        return m_content;
+    }
+};
+
+} // namespace
+
+// A reference counted pointer like Rc, but without support for weak references.
+//
+// The control block only holds the strong count and there is no implicit weak reference. Releasing
+// the last reference hands the value to RcDropQueue like Rc, which destroys it and frees the memory
+// together, without a second decrement for the weak count. This makes the allocation smaller and
+// saves the weak count bookkeeping for types that never need a Weak.
+// There is no Weak for an RcStrongOnly, trying to create one does not compile.
+template<typename T, typename Counter = std::size_t>
+class RcStrongOnly
+{
+public:
+    ~RcStrongOnly()
+    {
+        reset();
+    }
+
+    RcStrongOnly() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    RcStrongOnly(RcStrongOnly &&other) noexcept
+        : RcStrongOnly()
+    {
+        swap(*this, other);
+    }
+
+    RcStrongOnly(const RcStrongOnly &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    friend void swap(RcStrongOnly &first, RcStrongOnly &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    RcStrongOnly &operator=(RcStrongOnly other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    template<typename... Args>
+    static RcStrongOnly make(Args &&...args)
+    {
+        auto *value = new RcStrongValue<T, Counter>(std::forward<Args>(args)...);
+        value->incrementStrong();
+        return RcStrongOnly(value);
+    }
+
+    void reset()
+    {
+        if (m_value && m_value->decrementStrong() == 0) {
+            // the value may own a long chain, see RcDropQueue
+            RcDropQueue::release(m_value, nullptr, &RcStrongOnly::destroy);
+        }
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return m_value->content();
+    }
+
+    T *operator->() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    static void destroy(void *value, void *) noexcept
+    {
+        delete static_cast<RcStrongValue<T, Counter> *>(value);
+    }
+
+    explicit RcStrongOnly(RcStrongValue<T, Counter> *value)
+        : m_value(value)
+    {
+    }
+
+    RcStrongValue<T, Counter> *m_value;
+};
+
+template<typename T, typename... Args>
+RcStrongOnly<T> make_rc_strong_only(Args &&...args)
+{
+    return RcStrongOnly<T>::make(std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <rcpp/rc_array.h>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Rcpp {
+
+// Tag for an Rc to a Header that is followed by a runtime number of Elems in the same
+// allocation, like a flexible array member. See make_rc_with_trailing.
+template<typename Header, typename Elem>
+struct RcTrailing {
+};
+
+namespace {
+
+// The control block of an Rc<RcTrailing<Header, Elem>> together with the header.
+// The elements follow in the same allocation, see RcTrailingAllocation.
+template<typename Header, typename Elem, typename Counter>
+class RcValue<RcTrailing<Header, Elem>, Counter> : public RcControlBlock<Counter>
+{
+public:
+    template<typename... Args>
+    RcValue(std::size_t size, std::size_t alignment, Args &&...args)
+        : m_size(size, alignment), m_header(std::forward<Args>(args)...)
+    {
+    }
+
+    // the header is destructed by destructContent with the last strong reference
+    ~RcValue() { }
+
+    std::size_t size() const noexcept
+    {
+        return m_size.size();
+    }
+
+    Elem *data() const noexcept
+    {
+        return m_size.template elements<Elem>(this);
+    }
+
+    Header &header() noexcept
+    {
+        return m_header;
+    }
+
+    // the elements may refer to the header, so they are destructed first
+    void destructContent() noexcept
+    {
+        std::destroy_n(data(), size());
+        m_header.~Header();
+    }
+
+    // blocks with trailing elements always have custom deallocation
+    void deallocate() noexcept
+    {
+        this->deallocator()(this, RcDeallocation::ControlBlock);
+    }
+
+private:
+    RcTrailingSize m_size;
+    union {
+        Header m_header;
+    };
+};
+
+} // namespace
+
+// A reference counted Header followed by a runtime number of Elems, created by make_rc_with_trailing.
+//
+// operator* and operator-> access the header, trailing() the elements. Compared to a Header that
+// holds a std::vector<Elem>, this saves an allocation and an indirection.
+template<typename Header, typename Elem, typename Counter>
+class Rc<RcTrailing<Header, Elem>, Counter>
+{
+public:
+    template<typename U, typename C>
+    friend class Weak;
+
+    ~Rc()
+    {
+        reset();
+    }
+
+    Rc() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    Rc(Rc &&other) noexcept
+        : Rc()
+    {
+        swap(*this, other);
+    }
+
+    Rc(const Rc &other) noexcept
+        : m_value(other.m_value)
+    {
+        if (m_value) {
+            m_value->incrementStrong();
+        }
+    }
+
+    friend void swap(Rc &first, Rc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    Rc &operator=(Rc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    // Creates a Header from args followed by size value-initialized elements,
+    // whose memory is aligned to at least Alignment.
+    template<std::size_t Alignment = alignof(Elem), typename... Args>
+    static Rc make(std::size_t size, Args &&...args)
+    {
+        using Value = RcValue<RcTrailing<Header, Elem>, Counter>;
+        auto *value = RcTrailingAllocation<Value, Elem, Counter, Alignment>::create(size, std::forward<Args>(args)...);
+        try {
+            std::uninitialized_value_construct_n(value->data(), size);
+        } catch (...) {
+            value->header().~Header();
+            value->deallocate();
+            throw;
+        }
+        // the implicit weak reference of all strong references, see Rc<T>::make
+        value->incrementWeak();
+        return Rc(*value);
+    }
+
+    void reset()
+    {
+        if (m_value) {
+            if (m_value->decrementStrong() == 0) {
+                // destroys the elements and removes the implicit weak reference, see Rc<T>::reset
+                RcDropQueue::release(*m_value);
+            }
+        }
+        m_value = nullptr;
+    }
+
+    Header &operator*() const noexcept
+    {
+        return m_value->header();
+    }
+
+    Header *operator->() const noexcept
+    {
+        return &m_value->header();
+    }
+
+    RcSpan<Elem> trailing() const noexcept
+    {
+        return m_value ? RcSpan<Elem>(m_value->data(), m_value->size()) : RcSpan<Elem>(nullptr, 0);
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    RcValue<RcTrailing<Header, Elem>, Counter> *m_value;
+
+    Rc(RcValue<RcTrailing<Header, Elem>, Counter> &value)
+        : m_value(&value)
+    {
+        m_value->incrementStrong();
+    }
+};
+
+// Creates a Header from headerArgs that is followed by n value-initialized Elems in a single allocation.
+template<typename Header, typename Elem, std::size_t Alignment = alignof(Elem), typename... Args>
+Rc<RcTrailing<Header, Elem>> make_rc_with_trailing(std::size_t n, Args &&...headerArgs)
+{
+    return Rc<RcTrailing<Header, Elem>>::template make<Alignment>(n, std::forward<Args>(headerArgs)...);
+}
+
+} // namespace Rcpp
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <rcpp/rc.h>
+
+#include <utility>
+
+namespace Rcpp {
+
+// Memory for the value of an Rc<T> that is not constructed yet, like Rust's Rc<MaybeUninit<T>>.
+//
+// Either construct the value with emplace, or create it by writing to data() (e.g. with memcpy or
+// a read from a file, for trivially copyable types) and call assume_init. Both turn the RcUninit
+// into an Rc to the value in the same allocation. An RcUninit that is destroyed before frees the
+// memory without destructing a value.
+template<typename T, typename Counter>
+class RcUninit
+{
+public:
+    ~RcUninit()
+    {
+        if (m_value) {
+            Rc<T, Counter>::releaseUninitialized(*m_value);
+        }
+    }
+
+    RcUninit() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    RcUninit(RcUninit &&other) noexcept
+        : RcUninit()
+    {
+        swap(*this, other);
+    }
+
+    RcUninit(const RcUninit &) = delete;
+
+    RcUninit &operator=(RcUninit other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(RcUninit &first, RcUninit &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    // Allocates the memory like make_rc, but does not construct the value.
+    static RcUninit make()
+    {
+        RcUninit result;
+        result.m_value = Rc<T, Counter>::makeUninitialized();
+        return result;
+    }
+
+    // The memory of the value, suitably aligned for a T.
+    void *data() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    // Constructs the value from args and turns uninit into an Rc to it.
+    template<typename... Args>
+    static Rc<T, Counter> emplace(RcUninit &&uninit, Args &&...args)
+    {
+        ::new (uninit.data()) T(std::forward<Args>(args)...);
+        return assume_init(std::move(uninit));
+    }
+
+    // Turns uninit into an Rc to its value, which must have been created in data() before.
+    static Rc<T, Counter> assume_init(RcUninit &&uninit) noexcept
+    {
+        auto *value = uninit.m_value;
+        uninit.m_value = nullptr;
+        return Rc<T, Counter>::adopt(*value);
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    RcValue<T, Counter> *m_value;
+};
+
+template<typename T>
+RcUninit<T> make_rc_uninit()
+{
+    return RcUninit<T>::make();
+}
+
+} // namespace Rcpp
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <rcpp/weak.h>
+
+#include <utility>
+
+namespace Rcpp {
+
+// A uniquely owned value that can later be shared as an Rc without reallocation.
+//
+// A UniqueRc allows mutable access to its value. Weaks to it can already be created with downgrade(),
+// but can not be locked while the value is uniquely owned. into_rc turns the UniqueRc into an Rc,
+// after which the Weaks can be locked. This allows building cyclic structures where the
+// value only needs to be mutated during construction.
+template<typename T, typename Counter>
+class UniqueRc
+{
+public:
+    ~UniqueRc()
+    {
+        reset();
+    }
+
+    UniqueRc() noexcept
+        : m_value{ nullptr }
+    {
+    }
+
+    UniqueRc(UniqueRc &&other) noexcept
+        : UniqueRc()
+    {
+        swap(*this, other);
+    }
+
+    UniqueRc(const UniqueRc &) = delete;
+
+    UniqueRc &operator=(UniqueRc other) noexcept
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(UniqueRc &first, UniqueRc &second) noexcept
+    {
+        using std::swap;
+
+        swap(first.m_value, second.m_value);
+    }
+
+    template<typename... Args>
+    static UniqueRc make(Args &&...args)
+    {
+        auto rc = Rc<T, Counter>::make(std::forward<Args>(args)...);
+
+        UniqueRc result;
+        result.m_value = rc.m_value;
+        rc.m_value = nullptr;
+        // the strong count stays zero while the value is uniquely owned
+        result.m_value->decrementStrong();
+        return result;
+    }
+
+    // Turns unique into an Rc to the same value, unique is empty afterwards.
+    static Rc<T, Counter> into_rc(UniqueRc &&unique) noexcept
+    {
+        if (!unique) {
+            return {};
+        }
+        Rc<T, Counter> rc(*unique.m_value);
+        unique.m_value = nullptr;
+        return rc;
+    }
+
+    // Creates a Weak to the value, which can be locked once the value is turned into an Rc.
+    Weak<T, Counter> downgrade() const
+    {
+        return m_value ? Weak<T, Counter>(*m_value) : Weak<T, Counter>();
+    }
+
+    void reset()
+    {
+        if (m_value) {
+            // the value may own a long chain of Rcs, see RcDropQueue
+            RcDropQueue::release(*m_value);
+        }
+        m_value = nullptr;
+    }
+
+    T &operator*() const noexcept
+    {
+        return m_value->content();
+    }
+
+    T *operator->() const noexcept
+    {
+        return &m_value->content();
+    }
+
+    operator bool() const noexcept
+    {
+        return m_value;
+    }
+
+private:
+    RcValue<T, Counter> *m_value;
+};
+
+template<typename T, typename... Args>
+UniqueRc<T> make_unique_rc(Args &&...args)
+{
+    return UniqueRc<T>::make(std::forward<Args>(args)...);
+}
+
+} // namespace Rcpp
@@ -2,13 +2,21 @@
 
 #include <rcpp/rc.h>
 
+#include <utility>
+
 namespace Rcpp {
 
-template<typename T>
+template<typename T, typename Counter>
 class Weak
 {
 public:
-    Weak(const Rc<T> &strong)
+    template<typename U, typename C>
+    friend class UniqueRc;
+
+    template<typename U, typename C, typename F>
+    friend Rc<U, C> new_cyclic(F &&);
+
+    Weak(const Rc<T, Counter> &strong)
         : m_value(strong.m_value)
     {
         if (m_value) {
@@ -16,7 +24,7 @@ public:
         }
     }
 
-    Weak(const Weak<T> &other)
+    Weak(const Weak &other)
         : m_value(other.m_value)
     {
         if (m_value) {
@@ -24,7 +32,7 @@ public:
         }
     }
 
-    Weak(Weak<T> &&other)
+    Weak(Weak &&other)
         : Weak()
     {
         swap(*this, other);
@@ -33,20 +41,20 @@ public:
     Weak()
         : m_value(nullptr) { }
 
-    friend void swap(Weak<T> &first, Weak<T> &second) noexcept
+    friend void swap(Weak &first, Weak &second) noexcept
     {
         using std::swap;
 
         swap(first.m_value, second.m_value);
     }
 
-    Weak &operator=(Weak<T> other) noexcept
+    Weak &operator=(Weak other) noexcept
     {
         swap(*this, other);
         return *this;
     }
 
-    Weak &operator=(const Rc<T> &strong)
+    Weak &operator=(const Rc<T, Counter> &strong)
     {
         reset();
         m_value = strong.m_value;
@@ -61,26 +69,51 @@ public:
         reset();
     }
 
-    Rc<T> lock() const noexcept
+    Rc<T, Counter> lock() const noexcept
     {
         if (m_value && m_value->strong() > 0) {
-            return Rc<T>(*m_value);
+            return Rc<T, Counter>(*m_value);
         } else {
-            return Rc<T>();
+            return Rc<T, Counter>();
         }
     }
 
     void reset()
     {
         if (m_value && m_value->decrementWeak() == 0) {
-            delete m_value;
+            m_value->deallocate();
         }
 
         m_value = nullptr;
     }
 
 private:
-    RcValue<T> *m_value;
+    // for values that do not have a strong reference yet
+    explicit Weak(RcValue<T, Counter> &value)
+        : m_value(&value)
+    {
+        m_value->incrementWeak();
+    }
+
+    RcValue<T, Counter> *m_value;
 };
 
+// Creates an Rc to a value that refers to itself.
+//
+// The value is constructed from the result of f(weak), where weak is a Weak to the value under construction.
+// f can store copies of it (e.g. in child nodes), but they can only be locked once new_cyclic returns.
+template<typename T, typename Counter = std::size_t, typename F>
+Rc<T, Counter> new_cyclic(F &&f)
+{
+    auto *value = Rc<T, Counter>::makeUninitialized();
+    try {
+        const Weak<T, Counter> weak(*value);
+        ::new (static_cast<void *>(&value->content())) T(std::forward<F>(f)(weak));
+    } catch (...) {
+        Rc<T, Counter>::releaseUninitialized(*value);
+        throw;
+    }
+    return Rc<T, Counter>::adopt(*value);
+}
+
 } // namespace Rcpp
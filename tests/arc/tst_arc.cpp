@@ -0,0 +1,188 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/aweak.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <common/Counted.h>
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+using namespace Rcpp;
+
+static_assert(sizeof(Arc<int>) == sizeof(void *));
+// both counts are packed into a single word
+static_assert(sizeof(ArcControlBlock<std::uint32_t>) == sizeof(std::uint64_t));
+static_assert(sizeof(ArcValue<std::uint32_t, std::uint16_t>) == 2 * sizeof(std::uint32_t));
+
+struct Node {
+    Arc<Node> next;
+};
+
+TEST_CASE("Arc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        Arc<int> arc;
+        REQUIRE(!arc);
+    }
+
+    SUBCASE("Destructs its value with the last reference")
+    {
+        MemoryGuard guard;
+        {
+            auto arc = make_arc<InstanceCounter>(5);
+            REQUIRE(arc->value == 5);
+            {
+                auto copy = arc;
+                REQUIRE(&*copy == &*arc);
+                REQUIRE_INSTANCES(1);
+            }
+            REQUIRE_INSTANCES(1);
+
+            auto moved = std::move(arc);
+            REQUIRE(!arc);
+            REQUIRE((*moved).value == 5);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Supports custom counter types and incomplete types")
+    {
+        MemoryGuard guard;
+
+        auto arc = Arc<InstanceCounter, std::uint16_t>::make(3);
+        REQUIRE(arc->value == 3);
+
+        auto node = make_arc<Node>();
+        node->next = make_arc<Node>();
+    }
+}
+
+TEST_CASE("get_mut for Arc")
+{
+    MemoryGuard guard;
+
+    auto arc = make_arc<InstanceCounter>(5);
+    REQUIRE(get_mut(arc) == &*arc);
+    {
+        auto copy = arc;
+        REQUIRE(!get_mut(arc));
+    }
+    {
+        AWeak<InstanceCounter> weak(arc);
+        REQUIRE(!get_mut(arc));
+    }
+    get_mut(arc)->value = 6;
+    REQUIRE(arc->value == 6);
+}
+
+TEST_CASE("AWeak")
+{
+    SUBCASE("Does not keep the value alive")
+    {
+        MemoryGuard guard;
+
+        AWeak<InstanceCounter> weak;
+        REQUIRE(!weak.lock());
+        {
+            auto arc = make_arc<InstanceCounter>(5);
+            weak = arc;
+            auto locked = weak.lock();
+            REQUIRE(&*locked == &*arc);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Can be copied and moved")
+    {
+        MemoryGuard guard;
+
+        auto arc = make_arc<InstanceCounter>(5);
+        AWeak<InstanceCounter> weak(arc);
+        AWeak<InstanceCounter> copy(weak);
+        AWeak<InstanceCounter> moved(std::move(weak));
+        REQUIRE(!weak.lock());
+        REQUIRE(copy.lock());
+        REQUIRE(moved.lock()->value == 5);
+    }
+}
+
+TEST_CASE("Arc across threads")
+{
+    constexpr int Threads = 4;
+    constexpr int Iterations = 10000;
+
+    SUBCASE("Copies are released concurrently")
+    {
+        MemoryGuard guard;
+        {
+            auto shared = make_arc<InstanceCounter>(7);
+            std::atomic<int> sum = 0;
+
+            std::vector<std::thread> threads;
+            for (int i = 0; i < Threads; ++i) {
+                threads.emplace_back([shared, &sum] {
+                    for (int n = 0; n < Iterations; ++n) {
+                        auto copy = shared;
+                        AWeak<InstanceCounter> weak(copy);
+                        sum.fetch_add(weak.lock()->value, std::memory_order_relaxed);
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            REQUIRE(sum == Threads * Iterations * 7);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Locking races with releasing the last reference")
+    {
+        MemoryGuard guard;
+
+        for (int round = 0; round < 100; ++round) {
+            std::vector<Arc<Counted>> values;
+            std::vector<AWeak<Counted>> weaks;
+            for (int n = 0; n < 100; ++n) {
+                values.push_back(make_arc<Counted>(n));
+                weaks.emplace_back(values.back());
+            }
+
+            std::atomic<bool> dead = false;
+            // one thread drops the values while the others try to lock them
+            std::thread releaser([values = std::move(values)]() mutable { values.clear(); });
+            std::vector<std::thread> lockers;
+            for (int i = 0; i < Threads - 1; ++i) {
+                lockers.emplace_back([&weaks, &dead] {
+                    for (const auto &weak : weaks) {
+                        if (auto arc = weak.lock()) {
+                            // a locked value must still be alive
+                            if (arc->value < 0 || Counted::alive <= 0) {
+                                dead = true;
+                            }
+                        }
+                    }
+                });
+            }
+            releaser.join();
+            for (auto &thread : lockers) {
+                thread.join();
+            }
+            REQUIRE(!dead);
+            REQUIRE(Counted::alive == 0);
+            for (const auto &weak : weaks) {
+                REQUIRE(!weak.lock());
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/prc.h>
+#include <rcpp/pweak.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <vector>
+
+using namespace Rcpp;
+
+struct Node {
+    int value = 0;
+    Rc<Node> left;
+    Rc<Node> right;
+};
+
+TEST_CASE("RcArena")
+{
+    SUBCASE("make_rc allocates from the active arena")
+    {
+        RcArena arena;
+        REQUIRE(RcArena::current() == &arena);
+
+        MemoryGuard guard;
+        {
+            auto first = make_rc<InstanceCounter>(1);
+            auto second = make_rc<InstanceCounter>(2);
+            REQUIRE(first->value == 1);
+            REQUIRE(second->value == 2);
+            REQUIRE_INSTANCES(2);
+
+            auto *firstAddress = reinterpret_cast<char *>(&*first);
+            auto *secondAddress = reinterpret_cast<char *>(&*second);
+            REQUIRE(secondAddress > firstAddress);
+            REQUIRE(secondAddress - firstAddress < 128);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Arenas can be nested")
+    {
+        REQUIRE(RcArena::current() == nullptr);
+        {
+            RcArena outer;
+            {
+                RcArena inner;
+                REQUIRE(RcArena::current() == &inner);
+                auto rc = make_rc<InstanceCounter>();
+                REQUIRE_INSTANCES(1);
+            }
+            REQUIRE(RcArena::current() == &outer);
+        }
+        REQUIRE(RcArena::current() == nullptr);
+    }
+
+    SUBCASE("Weak and Prc work with arena values")
+    {
+        RcArena arena;
+
+        Weak<InstanceCounter> weak;
+        Pweak<Base> pweak;
+        {
+            auto rc = make_rc<InstanceCounter>();
+            weak = rc;
+            Prc<Base> prc = static_pointer_cast<Base>(make_prc<InstanceCounter>());
+            pweak = prc;
+            REQUIRE_INSTANCES(2);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+        REQUIRE(!pweak.lock());
+        weak.reset();
+        pweak.reset();
+    }
+
+    SUBCASE("Can hold a large object graph")
+    {
+        RcArena arena(256);
+
+        {
+            std::vector<Rc<Node>> level;
+            for (int i = 0; i < 1024; ++i) {
+                level.push_back(make_rc<Node>());
+                level.back()->value = i;
+            }
+            while (level.size() > 1) {
+                std::vector<Rc<Node>> next;
+                for (std::size_t i = 0; i < level.size(); i += 2) {
+                    auto node = make_rc<Node>();
+                    node->left = level[i];
+                    node->right = level[i + 1];
+                    next.push_back(std::move(node));
+                }
+                level = std::move(next);
+            }
+            auto leftmost = level.front();
+            while (leftmost->left) {
+                leftmost = leftmost->left;
+            }
+            REQUIRE(leftmost->value == 0);
+        }
+    }
+}
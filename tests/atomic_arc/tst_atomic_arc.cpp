@@ -0,0 +1,164 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/atomic_arc.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <common/Counted.h>
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+using namespace Rcpp;
+
+static_assert(sizeof(AtomicArc<int>) == sizeof(void *));
+// load() waits for other readers if they exhausted the reserve
+static_assert(!AtomicArc<int>::is_lock_free());
+
+TEST_CASE("AtomicArc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        AtomicArc<int> cell;
+        REQUIRE(!cell.load());
+    }
+
+    SUBCASE("Keeps its value alive")
+    {
+        MemoryGuard guard;
+        {
+            AtomicArc<InstanceCounter> cell(make_arc<InstanceCounter>(5));
+            REQUIRE(cell.load()->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Loads share the stored value")
+    {
+        MemoryGuard guard;
+
+        auto arc = make_arc<InstanceCounter>(5);
+        AtomicArc<InstanceCounter> cell(arc);
+        auto first = cell.load();
+        auto second = cell.load();
+        REQUIRE(&*first == &*arc);
+        REQUIRE(&*second == &*arc);
+    }
+
+    SUBCASE("Store replaces the value")
+    {
+        MemoryGuard guard;
+
+        AtomicArc<InstanceCounter> cell(make_arc<InstanceCounter>(1));
+        auto old = cell.load();
+        cell.store(make_arc<InstanceCounter>(2));
+        REQUIRE(cell.load()->value == 2);
+        REQUIRE(old->value == 1);
+        REQUIRE_INSTANCES(2);
+        old.reset();
+        REQUIRE_INSTANCES(1);
+        cell.store({});
+        REQUIRE(!cell.load());
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Exchange returns the previous value with exact counts")
+    {
+        MemoryGuard guard;
+
+        AtomicArc<InstanceCounter> cell(make_arc<InstanceCounter>(1));
+        auto loaded = cell.load();
+        auto previous = cell.exchange(make_arc<InstanceCounter>(2));
+        REQUIRE(&*previous == &*loaded);
+        REQUIRE(!get_mut(previous));
+        loaded.reset();
+        // the cell released all references it was charged with
+        REQUIRE(get_mut(previous) == &*previous);
+    }
+
+    SUBCASE("Compare exchange only replaces the expected value")
+    {
+        MemoryGuard guard;
+
+        auto first = make_arc<InstanceCounter>(1);
+        AtomicArc<InstanceCounter> cell(first);
+
+        auto expected = make_arc<InstanceCounter>(3);
+        REQUIRE(!cell.compare_exchange_strong(expected, make_arc<InstanceCounter>(2)));
+        REQUIRE(&*expected == &*first);
+        REQUIRE_INSTANCES(1);
+
+        REQUIRE(cell.compare_exchange_weak(expected, make_arc<InstanceCounter>(2)));
+        REQUIRE(cell.load()->value == 2);
+        expected.reset();
+        REQUIRE(get_mut(first) == &*first);
+    }
+
+    SUBCASE("Recharges its references after many loads")
+    {
+        MemoryGuard guard;
+
+        AtomicArc<InstanceCounter> cell(make_arc<InstanceCounter>(5));
+        std::vector<Arc<InstanceCounter>> loaded;
+        for (int i = 0; i < 200000; ++i) {
+            loaded.push_back(cell.load());
+        }
+        loaded.clear();
+        auto previous = cell.exchange({});
+        REQUIRE(get_mut(previous) == &*previous);
+    }
+}
+
+TEST_CASE("AtomicArc across threads")
+{
+    constexpr int Readers = 4;
+    constexpr int Iterations = 20000;
+
+    MemoryGuard guard;
+    {
+        AtomicArc<Counted> cell(make_arc<Counted>(0));
+        std::atomic<bool> done = false;
+        std::atomic<bool> broken = false;
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < Readers; ++i) {
+            readers.emplace_back([&] {
+                int last = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    auto arc = cell.load();
+                    // the stored values only ever increase and must still be alive
+                    if (arc->value < last || Counted::alive <= 0) {
+                        broken = true;
+                    }
+                    last = arc->value;
+                }
+            });
+        }
+
+        std::thread writer([&] {
+            for (int n = 1; n <= Iterations; ++n) {
+                if (n % 2) {
+                    cell.store(make_arc<Counted>(n));
+                } else {
+                    auto expected = cell.load();
+                    while (!cell.compare_exchange_weak(expected, make_arc<Counted>(n))) { }
+                }
+            }
+            done = true;
+        });
+
+        writer.join();
+        for (auto &thread : readers) {
+            thread.join();
+        }
+        REQUIRE(!broken);
+        REQUIRE(cell.load()->value == Iterations);
+        REQUIRE(Counted::alive == 1);
+    }
+    REQUIRE(Counted::alive == 0);
+}
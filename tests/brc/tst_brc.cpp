@@ -0,0 +1,157 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/brc.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <common/Counted.h>
+#include <common/MemoryGuard.h>
+
+using namespace Rcpp;
+
+static_assert(sizeof(Brc<int>) == sizeof(void *));
+
+// Constructed before the BrcThread of its thread, so it is destroyed after it.
+struct LateBrc {
+    ~LateBrc()
+    {
+        auto brc = make_brc<Counted>(7);
+        auto copy = brc;
+        *target = copy;
+    }
+
+    static inline Brc<Counted> *target = nullptr;
+};
+
+TEST_CASE("Brc")
+{
+    SUBCASE("Is destroyed immediately on its owning thread")
+    {
+        {
+            auto brc = make_brc<Counted>(5);
+            auto copy = brc;
+            REQUIRE(copy->value == 5);
+            REQUIRE(&*copy == &*brc);
+
+            auto moved = std::move(brc);
+            REQUIRE(!brc);
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(merge_biased_counts() == 0);
+    }
+
+    SUBCASE("References released by other threads are merged by the owner")
+    {
+        auto brc = make_brc<Counted>(5);
+        std::thread([brc = std::move(brc)]() mutable { brc.reset(); }).join();
+        REQUIRE(Counted::alive == 1);
+
+        REQUIRE(merge_biased_counts() == 1);
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SUBCASE("Is destroyed by the last thread once the owner released its references")
+    {
+        auto brc = make_brc<Counted>(5);
+        std::atomic<int> step = 0;
+        std::thread other([&brc, &step] {
+            auto copy = brc;
+            step = 1;
+            while (step != 2) {
+                std::this_thread::yield();
+            }
+            copy.reset();
+        });
+        while (step != 1) {
+            std::this_thread::yield();
+        }
+        // gives up the bias, the count of the other thread remains
+        brc.reset();
+        REQUIRE(Counted::alive == 1);
+        step = 2;
+        other.join();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SUBCASE("Values of exited threads are merged by the releasing thread")
+    {
+        MemoryGuard guard;
+        {
+            Brc<Counted> brc;
+            std::thread([&brc] {
+                brc = make_brc<Counted>(5);
+                auto copy = brc;
+            }).join();
+            REQUIRE(brc->value == 5);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SUBCASE("Values of exited threads can own further values of the thread")
+    {
+        struct Outer {
+            Brc<Counted> inner;
+        };
+
+        MemoryGuard guard;
+        {
+            Brc<Outer> outer;
+            std::thread([&outer] { outer = make_brc<Outer>(Outer { make_brc<Counted>(5) }); }).join();
+            REQUIRE(outer->inner->value == 5);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SUBCASE("Values created after the thread-local objects of a thread are destroyed have no owner")
+    {
+        MemoryGuard guard;
+        {
+            Brc<Counted> target;
+            LateBrc::target = &target;
+            std::thread([] {
+                static thread_local LateBrc late;
+                auto owned = make_brc<Counted>(1);
+            }).join();
+            REQUIRE(target->value == 7);
+            REQUIRE(Counted::alive == 1);
+        }
+        // the value is shared from the start, so it is not waiting for an owner to merge it
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SUBCASE("Can be shared between threads")
+    {
+        constexpr int Threads = 4;
+        constexpr int Iterations = 10000;
+
+        auto shared = make_brc<Counted>(1);
+        std::atomic<int> sum = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < Threads; ++i) {
+            threads.emplace_back([shared, &sum] {
+                auto own = make_brc<Counted>(1);
+                for (int n = 0; n < Iterations; ++n) {
+                    auto copy = shared;
+                    auto ownCopy = own;
+                    sum.fetch_add(copy->value + ownCopy->value, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (int n = 0; n < Iterations; ++n) {
+            auto copy = shared;
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        REQUIRE(sum == 2 * Threads * Iterations);
+        REQUIRE(Counted::alive == 1);
+
+        shared.reset();
+        merge_biased_counts();
+        REQUIRE(Counted::alive == 0);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <atomic>
+
+// Counts its live instances like InstanceCounter, but atomically, so values of this type may be
+// created and destroyed on any thread.
+struct Counted {
+    explicit Counted(int value)
+        : value(value)
+    {
+        alive++;
+    }
+
+    ~Counted()
+    {
+        // a destroyed value that is still read shows up as a changed value
+        value = -1;
+        alive--;
+    }
+
+    int value;
+
+    static inline std::atomic<int> alive = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+struct AllocationStats {
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+    std::size_t live() const
+    {
+        return allocations - deallocations;
+    }
+};
+
+// A stateful allocator that records its allocations in an AllocationStats instance.
+template<typename T>
+class CountingAllocator
+{
+public:
+    using value_type = T;
+
+    explicit CountingAllocator(AllocationStats &stats) noexcept
+        : m_stats(&stats)
+    {
+    }
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U> &other) noexcept
+        : m_stats(other.stats())
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        m_stats->allocations++;
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t)
+    {
+        m_stats->deallocations++;
+        ::operator delete(pointer);
+    }
+
+    AllocationStats *stats() const noexcept
+    {
+        return m_stats;
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U> &other) const noexcept
+    {
+        return m_stats == other.stats();
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U> &other) const noexcept
+    {
+        return m_stats != other.stats();
+    }
+
+private:
+    AllocationStats *m_stats;
+};
@@ -41,6 +41,13 @@ public:
         copies++;
     }
 
+    // moving is not counted as a copy
+    InstanceCounter(InstanceCounter &&other) noexcept
+        : value(other.value)
+    {
+        instances++;
+    }
+
     bool isBase() override
     {
         return false;
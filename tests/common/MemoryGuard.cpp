@@ -1,12 +1,14 @@
 #include "MemoryGuard.h"
 
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <new>
 
 #include <doctest.h>
 
-static std::size_t allocations = 0;
+// atomic, as the tests of the thread-safe pointers allocate from multiple threads
+static std::atomic<std::size_t> allocations = 0;
 
 // Example adapted from: https://en.cppreference.com/w/cpp/memory/new/operator_new
 // replacement of a minimal set of functions:
@@ -29,6 +31,12 @@ void operator delete(void *ptr) noexcept
     allocations--;
 }
 
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+    allocations--;
+}
+
 MemoryGuard::MemoryGuard() 
 {
     m_allocationsAtStart = allocations;
@@ -38,6 +46,6 @@ MemoryGuard::~MemoryGuard()
 {
     // We cannot use REQUIRE here, as it actually does allocations, therefore failing the check
     if(m_allocationsAtStart != allocations) {
-        FAIL("Memory leak! Old allocations: ", m_allocationsAtStart, " New allocations: ", allocations);
+        FAIL("Memory leak! Old allocations: ", m_allocationsAtStart, " New allocations: ", allocations.load());
     }
 }
@@ -0,0 +1,232 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/cycles.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Rcpp;
+
+struct Node : public InstanceCounter {
+    std::vector<Rc<Node>> edges;
+
+    void trace(RcTracer &tracer) const
+    {
+        for (const auto &edge : edges) {
+            tracer(edge);
+        }
+    }
+};
+
+struct Untraced : public InstanceCounter {
+    Rc<Untraced> next;
+};
+
+static_assert(RcTraceable<Node>::value);
+static_assert(!RcTraceable<Untraced>::value);
+static_assert(!RcTraceable<int>::value);
+
+TEST_CASE("Cycle collection")
+{
+    SUBCASE("Frees a self cycle")
+    {
+        MemoryGuard guard;
+        {
+            auto node = make_rc<Node>();
+            node->edges.push_back(node);
+        }
+        REQUIRE_INSTANCES(1);
+        REQUIRE(RcCycleCollector::roots() == 1);
+
+        REQUIRE(collect_cycles() == 1);
+        REQUIRE_INSTANCES(0);
+        REQUIRE(RcCycleCollector::roots() == 0);
+    }
+
+    SUBCASE("Frees a cycle of multiple values")
+    {
+        MemoryGuard guard;
+        {
+            auto a = make_rc<Node>();
+            auto b = make_rc<Node>();
+            auto c = make_rc<Node>();
+            a->edges.push_back(b);
+            b->edges.push_back(c);
+            c->edges.push_back(a);
+            // values hanging off the cycle are garbage as well
+            c->edges.push_back(make_rc<Node>());
+        }
+        REQUIRE_INSTANCES(4);
+
+        REQUIRE(collect_cycles() == 4);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Keeps cycles that are still referenced")
+    {
+        MemoryGuard guard;
+        {
+            auto a = make_rc<Node>();
+            {
+                auto b = make_rc<Node>();
+                a->edges.push_back(b);
+                b->edges.push_back(a);
+            }
+            REQUIRE(collect_cycles() == 0);
+            REQUIRE_INSTANCES(2);
+            REQUIRE(&*a->edges.front()->edges.front() == &*a);
+        }
+        REQUIRE(collect_cycles() == 2);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Keeps values referenced from outside of a cycle")
+    {
+        MemoryGuard guard;
+        Rc<Node> outside;
+        {
+            auto a = make_rc<Node>();
+            auto b = make_rc<Node>();
+            a->edges.push_back(b);
+            b->edges.push_back(a);
+            b->edges.push_back(make_rc<Node>());
+            outside = b->edges.back();
+        }
+        REQUIRE(collect_cycles() == 2);
+        REQUIRE_INSTANCES(1);
+        outside.reset();
+        REQUIRE(collect_cycles() == 0);
+    }
+
+    SUBCASE("Roots released without a cycle leave the buffer")
+    {
+        MemoryGuard guard;
+        {
+            auto a = make_rc<Node>();
+            auto copy = a;
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(RcCycleCollector::roots() == 0);
+        REQUIRE(collect_cycles() == 0);
+    }
+
+    SUBCASE("Buffers each value only once")
+    {
+        MemoryGuard guard;
+        {
+            auto a = make_rc<Node>();
+            auto b = make_rc<Node>();
+            for (int i = 0; i < 5000; ++i) {
+                auto copyA = a;
+                auto copyB = b;
+            }
+            REQUIRE(RcCycleCollector::roots() == 2);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(collect_cycles() == 0);
+    }
+
+    SUBCASE("Weak references to collected values expire")
+    {
+        MemoryGuard guard;
+        Weak<Node> weak;
+        {
+            auto node = make_rc<Node>();
+            node->edges.push_back(node);
+            weak = node;
+        }
+        REQUIRE(weak.lock());
+        REQUIRE(collect_cycles() == 1);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Buffered values are not kept alive")
+    {
+        MemoryGuard guard;
+        auto a = make_rc<Node>();
+        {
+            auto copy = a;
+        }
+        REQUIRE(RcCycleCollector::roots() == 1);
+
+        // the buffer holds no reference, so a is still unique
+        auto *value = &*a;
+        REQUIRE(get_mut(a) == value);
+        make_mut(a);
+        REQUIRE(&*a == value);
+
+        a.reset();
+        REQUIRE_INSTANCES(0);
+        REQUIRE(RcCycleCollector::roots() == 0);
+        REQUIRE(collect_cycles() == 0);
+    }
+
+    SUBCASE("Values in an arena can be buffered")
+    {
+        MemoryGuard guard;
+        {
+            RcArena arena;
+            auto a = make_rc<Node>();
+            {
+                auto copy = a;
+            }
+            auto cycle = make_rc<Node>();
+            cycle->edges.push_back(cycle);
+            cycle.reset();
+            REQUIRE(RcCycleCollector::roots() == 2);
+
+            REQUIRE(collect_cycles() == 1);
+            {
+                auto copy = a;
+            }
+            // all values are gone before the arena, also the buffered one
+            a.reset();
+            REQUIRE(RcCycleCollector::roots() == 0);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(collect_cycles() == 0);
+    }
+
+    SUBCASE("Values released after the buffer of the thread is destroyed are not buffered")
+    {
+        // constructed before the buffer of the thread, so it is destroyed after it
+        struct Holder {
+            // buffered while the buffer exists
+            Rc<Node> buffered = make_rc<Node>();
+            Rc<Node> a = make_rc<Node>();
+            // destroyed first, while a still refers to the value
+            Rc<Node> b = a;
+        };
+
+        MemoryGuard guard;
+        std::thread([] {
+            static thread_local Holder holder;
+            {
+                auto copy = holder.buffered;
+            }
+        }).join();
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Types without trace are never buffered")
+    {
+        MemoryGuard guard;
+        auto a = make_rc<Untraced>();
+        a->next = a;
+        {
+            auto copy = a;
+        }
+        REQUIRE(RcCycleCollector::roots() == 0);
+        REQUIRE(collect_cycles() == 0);
+        REQUIRE_INSTANCES(1);
+
+        a->next.reset();
+        a.reset();
+        REQUIRE_INSTANCES(0);
+    }
+}
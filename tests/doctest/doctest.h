@@ -4296,7 +4296,8 @@ namespace {
         static bool             isSet;
         static struct sigaction oldSigActions[DOCTEST_COUNTOF(signalDefs)];
         static stack_t          oldSigStack;
-        static char             altStackMem[4 * SIGSTKSZ];
+        static constexpr std::size_t altStackSize = 4 * 8192;
+        static char             altStackMem[altStackSize];
 
         static void handleSignal(int sig) {
             const char* name = "<unknown signal>";
@@ -0,0 +1,105 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/enable_rc_from_this.h>
+#include <rcpp/prc.h>
+
+#include <common/CountingAllocator.h>
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <cstdint>
+
+using namespace Rcpp;
+
+class Self : public enable_rc_from_this<Self>
+    , public InstanceCounter
+{
+public:
+    Rc<Self> self() const
+    {
+        return rc_from_this();
+    }
+};
+
+class SmallSelf : public enable_rc_from_this<SmallSelf, std::uint16_t>
+{
+};
+
+TEST_CASE("enable_rc_from_this")
+{
+    SUBCASE("Returns an Rc to values created by make_rc")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc<Self>();
+            auto self = rc->self();
+            REQUIRE(&*self == &*rc);
+            REQUIRE(rc->weak_from_this().lock());
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Does not keep the value alive")
+    {
+        MemoryGuard guard;
+
+        Weak<Self> weak;
+        {
+            auto rc = make_rc<Self>();
+            weak = rc->weak_from_this();
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Returns an empty Rc for values not owned by an Rc")
+    {
+        MemoryGuard guard;
+
+        Self self;
+        REQUIRE(!self.self());
+
+        auto rc = make_rc<Self>();
+        // a copy is a different value
+        Self copy(*rc);
+        REQUIRE(!copy.self());
+    }
+
+    SUBCASE("Works with allocators and custom counters")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+        {
+            auto rc = allocate_rc<Self>(CountingAllocator<Self>(stats));
+            REQUIRE(&*rc->self() == &*rc);
+
+            auto small = Rc<SmallSelf, std::uint16_t>::make();
+            REQUIRE(&*small->rc_from_this() == &*small);
+        }
+        REQUIRE(stats.live() == 0);
+    }
+}
+
+TEST_CASE("enable_rc_from_this does not prevent unique access")
+{
+    MemoryGuard guard;
+
+    auto rc = make_rc<Self>();
+    REQUIRE(get_mut(rc) == &*rc);
+    {
+        Prc<Self> prc = rc;
+        REQUIRE(!get_mut(prc));
+    }
+    {
+        Prc<Self> prc = std::move(rc);
+        REQUIRE(get_mut(prc) == &*prc);
+        rc = prc->self();
+    }
+
+    auto *value = &*rc;
+    rc = Rc<Self>::reuse_or_make(std::move(rc));
+    REQUIRE(&*rc == value);
+    REQUIRE(&*rc->self() == value);
+}
@@ -0,0 +1,244 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/epoch_arc.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <common/Counted.h>
+#include <common/InstanceCounter.h>
+
+using namespace Rcpp;
+
+static_assert(sizeof(EpochArc<int>) == sizeof(void *));
+static_assert(sizeof(AtomicEpochArc<int>) == sizeof(void *));
+
+// Released by its destructor after the thread-local objects of the main thread, including its epoch
+// participant, were destroyed. The value is then destroyed right away.
+static AtomicEpochArc<int> s_staticCell(make_epoch_arc<int>(7));
+
+// Reclaims everything once no other thread is pinned. Retired values need two epoch advances.
+static void reclaimAll()
+{
+    while (pending_retired() > 0) {
+        reclaim_retired();
+    }
+}
+
+TEST_CASE("EpochArc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        EpochArc<int> arc;
+        REQUIRE(!arc);
+    }
+
+    SUBCASE("Retires its value with the last reference")
+    {
+        {
+            auto arc = make_epoch_arc<InstanceCounter>(5);
+            auto copy = arc;
+            REQUIRE(copy->value == 5);
+            arc.reset();
+            REQUIRE_INSTANCES(1);
+        }
+        // the value is only destroyed once no thread can read it anymore
+        REQUIRE_INSTANCES(1);
+        REQUIRE(pending_retired() == 1);
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Values are collected while retiring further values")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            make_epoch_arc<InstanceCounter>(i);
+        }
+        REQUIRE(pending_retired() < 1000);
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("AtomicEpochArc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        AtomicEpochArc<int> cell;
+        EpochGuard guard;
+        REQUIRE(!cell.read(guard));
+        REQUIRE(!cell.load());
+    }
+
+    SUBCASE("A guard keeps read values alive")
+    {
+        {
+            AtomicEpochArc<InstanceCounter> cell(make_epoch_arc<InstanceCounter>(1));
+            {
+                EpochGuard guard;
+                const auto *value = cell.read(guard);
+                REQUIRE(value->value == 1);
+
+                cell.store(make_epoch_arc<InstanceCounter>(2));
+                REQUIRE(cell.read(guard)->value == 2);
+                reclaim_retired();
+                reclaim_retired();
+                REQUIRE_INSTANCES(2);
+                REQUIRE(value->value == 1);
+            }
+            reclaimAll();
+            REQUIRE_INSTANCES(1);
+        }
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Guards nest")
+    {
+        {
+            AtomicEpochArc<InstanceCounter> cell(make_epoch_arc<InstanceCounter>(1));
+            EpochGuard outer;
+            const auto *value = cell.read(outer);
+            {
+                EpochGuard inner;
+                cell.store({});
+            }
+            reclaim_retired();
+            reclaim_retired();
+            REQUIRE(value->value == 1);
+        }
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Loads count a reference")
+    {
+        {
+            AtomicEpochArc<InstanceCounter> cell(make_epoch_arc<InstanceCounter>(1));
+            auto loaded = cell.load();
+            cell.store({});
+            reclaimAll();
+            REQUIRE(loaded->value == 1);
+            REQUIRE_INSTANCES(1);
+        }
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Exchange and compare exchange")
+    {
+        {
+            auto first = make_epoch_arc<InstanceCounter>(1);
+            AtomicEpochArc<InstanceCounter> cell(first);
+
+            auto expected = make_epoch_arc<InstanceCounter>(3);
+            REQUIRE(!cell.compare_exchange_strong(expected, make_epoch_arc<InstanceCounter>(2)));
+            REQUIRE(&*expected == &*first);
+
+            REQUIRE(cell.compare_exchange_weak(expected, make_epoch_arc<InstanceCounter>(2)));
+            auto previous = cell.exchange(make_epoch_arc<InstanceCounter>(4));
+            REQUIRE(previous->value == 2);
+            REQUIRE(cell.load()->value == 4);
+        }
+        reclaimAll();
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("AtomicEpochArc across threads")
+{
+    constexpr int Readers = 4;
+    constexpr int Iterations = 20000;
+
+    {
+        AtomicEpochArc<Counted> cell(make_epoch_arc<Counted>(0));
+        std::atomic<bool> done = false;
+        std::atomic<bool> broken = false;
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < Readers; ++i) {
+            readers.emplace_back([&, i] {
+                int last = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    EpochGuard guard;
+                    const auto *value = cell.read(guard);
+                    // the stored values only ever increase and must not be destroyed while pinned
+                    if (value->value < last) {
+                        broken = true;
+                    }
+                    last = value->value;
+                    if (i == 0) {
+                        // counted loads retire values on reader threads as well
+                        auto loaded = cell.load();
+                        if (loaded->value < last) {
+                            broken = true;
+                        }
+                    }
+                }
+            });
+        }
+
+        std::thread writer([&] {
+            for (int n = 1; n <= Iterations; ++n) {
+                if (n % 2) {
+                    cell.store(make_epoch_arc<Counted>(n));
+                } else {
+                    auto expected = cell.load();
+                    while (!cell.compare_exchange_weak(expected, make_epoch_arc<Counted>(n))) { }
+                }
+            }
+            done = true;
+        });
+
+        writer.join();
+        for (auto &thread : readers) {
+            thread.join();
+        }
+        REQUIRE(!broken);
+        EpochGuard guard;
+        REQUIRE(cell.read(guard)->value == Iterations);
+    }
+    // the exited threads left their retired values behind, which any thread can reclaim
+    for (int i = 0; i < 10 && Counted::alive > 0; ++i) {
+        reclaim_retired();
+    }
+    REQUIRE(Counted::alive == 0);
+}
+
+// Constructed before the epoch participant of its thread, so it is destroyed after it.
+struct LateRelease {
+    ~LateRelease()
+    {
+        // pins the epoch with a borrowed participant
+        loaded = cell->load()->value;
+        arc.reset();
+    }
+
+    AtomicEpochArc<Counted> *cell = nullptr;
+    EpochArc<Counted> arc;
+
+    static inline std::atomic<int> loaded = 0;
+};
+
+TEST_CASE("Values released after the thread-local objects of a thread are destroyed")
+{
+    REQUIRE(*s_staticCell.load() == 7);
+    {
+        AtomicEpochArc<Counted> cell(make_epoch_arc<Counted>(3));
+        const int alive = Counted::alive;
+
+        std::thread([&cell] {
+            static thread_local LateRelease late;
+            late.cell = &cell;
+            late.arc = make_epoch_arc<Counted>(4);
+            REQUIRE(pending_retired() == 0);
+        }).join();
+
+        REQUIRE(LateRelease::loaded == 3);
+        // no thread was pinned, so the value of arc was destroyed right away
+        REQUIRE(Counted::alive == alive);
+    }
+    reclaimAll();
+}
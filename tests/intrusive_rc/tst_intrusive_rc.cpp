@@ -0,0 +1,154 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/intrusive_rc.h>
+
+#include <common/MemoryGuard.h>
+
+#include <cstdint>
+#include <new>
+
+using namespace Rcpp;
+
+class Shape : public IntrusiveRcBase<Shape>
+{
+public:
+    Shape()
+    {
+        instances++;
+    }
+
+    Shape(const Shape &other)
+        : IntrusiveRcBase<Shape>(other)
+    {
+        instances++;
+    }
+
+    Shape &operator=(const Shape &) = default;
+
+    virtual ~Shape()
+    {
+        instances--;
+    }
+
+    virtual int corners() const
+    {
+        return 0;
+    }
+
+    static inline int instances = 0;
+};
+
+class Square : public Shape
+{
+public:
+    int corners() const override
+    {
+        return 4;
+    }
+};
+
+// a type that lives in externally managed storage
+class Pooled : public IntrusiveRcBase<Pooled, std::uint32_t>
+{
+public:
+    static void destroyRc(Pooled *value) noexcept
+    {
+        value->~Pooled();
+        released++;
+    }
+
+    static inline int released = 0;
+};
+
+static_assert(sizeof(IntrusiveRc<Shape>) == sizeof(void *));
+static_assert(sizeof(Pooled) == sizeof(std::uint32_t));
+
+TEST_CASE("IntrusiveRc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        IntrusiveRc<Shape> rc;
+        REQUIRE(!rc);
+    }
+
+    SUBCASE("Counts references in the value")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_intrusive_rc<Shape>();
+            REQUIRE(rc->strongCount() == 1);
+            {
+                auto copy = rc;
+                REQUIRE(rc->strongCount() == 2);
+
+                IntrusiveRc<Shape> moved(std::move(copy));
+                REQUIRE(!copy);
+                REQUIRE(rc->strongCount() == 2);
+            }
+            REQUIRE(rc->strongCount() == 1);
+            REQUIRE(Shape::instances == 1);
+        }
+        REQUIRE(Shape::instances == 0);
+    }
+
+    SUBCASE("Can be created again from a raw pointer")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_intrusive_rc<Shape>();
+            IntrusiveRc<Shape> other(rc.get());
+            REQUIRE(rc->strongCount() == 2);
+            rc.reset();
+            REQUIRE(Shape::instances == 1);
+        }
+        REQUIRE(Shape::instances == 0);
+    }
+
+    SUBCASE("Copying the value does not copy the count")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_intrusive_rc<Shape>();
+            auto copy = make_intrusive_rc<Shape>(*rc);
+            REQUIRE(copy->strongCount() == 1);
+            *copy = *rc;
+            REQUIRE(copy->strongCount() == 1);
+        }
+        REQUIRE(Shape::instances == 0);
+    }
+
+    SUBCASE("Supports polymorphism with a single pointer")
+    {
+        MemoryGuard guard;
+        {
+            IntrusiveRc<Shape> shape = make_intrusive_rc<Square>();
+            REQUIRE(shape->corners() == 4);
+
+            auto square = dynamic_pointer_cast<Square>(shape);
+            REQUIRE(square);
+            REQUIRE(shape->strongCount() == 2);
+
+            auto base = static_pointer_cast<Shape>(square);
+            REQUIRE(shape->strongCount() == 3);
+            REQUIRE(!dynamic_pointer_cast<Square>(make_intrusive_rc<Shape>()));
+        }
+        REQUIRE(Shape::instances == 0);
+    }
+
+    SUBCASE("Releases values with a custom destroyRc")
+    {
+        MemoryGuard guard;
+        Pooled::released = 0;
+
+        alignas(Pooled) unsigned char storage[sizeof(Pooled)];
+        {
+            IntrusiveRc<Pooled> rc(::new (static_cast<void *>(storage)) Pooled());
+            auto copy = rc;
+            REQUIRE(copy->strongCount() == 2);
+        }
+        REQUIRE(Pooled::released == 1);
+    }
+}
@@ -0,0 +1,117 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/paweak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+using namespace Rcpp;
+
+template<typename Derived, typename Base, typename = void>
+struct CanDynamicBaseCast : std::false_type {
+};
+
+template<typename Derived, typename Base>
+struct CanDynamicBaseCast<Derived, Base, std::void_t<decltype(dynamic_base_pointer_cast<Derived>(std::declval<const Parc<Base> &>()))>> : std::true_type {
+};
+
+struct PlainBase {
+};
+
+struct PlainDerived : public PlainBase {
+};
+
+// the dynamic type of a non-polymorphic base can not be checked
+static_assert(CanDynamicBaseCast<InstanceCounter, Base>::value);
+static_assert(!CanDynamicBaseCast<PlainDerived, PlainBase>::value);
+
+TEST_CASE("Parc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        Parc<int> parc;
+        REQUIRE(!parc);
+    }
+
+    SUBCASE("Can be constructed from an Arc")
+    {
+        MemoryGuard guard;
+        {
+            auto arc = make_arc<InstanceCounter>(5);
+            Parc<InstanceCounter> parc(arc);
+            REQUIRE(&*parc == &*arc);
+
+            Parc<InstanceCounter> moved(std::move(arc));
+            REQUIRE(!arc);
+            REQUIRE(moved->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Destructs the value through its base class")
+    {
+        MemoryGuard guard;
+        {
+            Parc<Base> base = static_pointer_cast<Base>(make_arc<Derived>());
+            auto copy = base;
+            REQUIRE(!copy->isBase());
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("Parc casting")
+{
+    SUBCASE("A Parc can be dynamic cast")
+    {
+        MemoryGuard guard;
+
+        Parc<Base> base = static_pointer_cast<Base>(make_arc<InstanceCounter>(5));
+        auto counter = dynamic_pointer_cast<InstanceCounter>(base);
+        REQUIRE(counter->value == 5);
+        REQUIRE(!dynamic_pointer_cast<Derived>(base));
+
+        auto moved = dynamic_pointer_cast<InstanceCounter>(std::move(base));
+        REQUIRE(!base);
+        REQUIRE(moved);
+    }
+
+    SUBCASE("A Parc can be cast to an Arc if the type matches exactly")
+    {
+        MemoryGuard guard;
+
+        Parc<Base> base = static_pointer_cast<Base>(make_arc<InstanceCounter>(5));
+        REQUIRE(!dynamic_base_pointer_cast<Derived>(base));
+
+        auto arc = dynamic_base_pointer_cast<InstanceCounter>(base);
+        REQUIRE(arc->value == 5);
+
+        auto moved = dynamic_base_pointer_cast<InstanceCounter>(std::move(base));
+        REQUIRE(!base);
+        REQUIRE(&*moved == &*arc);
+    }
+}
+
+TEST_CASE("PAWeak")
+{
+    SUBCASE("Can be locked to a Parc while the value is alive")
+    {
+        MemoryGuard guard;
+
+        PAWeak<InstanceCounter> weak;
+        REQUIRE(!weak.lock());
+        {
+            auto parc = make_parc<InstanceCounter>(5);
+            weak = parc;
+            PAWeak<InstanceCounter> copy(weak);
+            REQUIRE(&*copy.lock() == &*parc);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+}
@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/pmr.h>
+#include <rcpp/pweak.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <memory_resource>
+#include <vector>
+
+using namespace Rcpp;
+
+// Forwards to the default resource and counts the outstanding bytes.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+
+private:
+    void *do_allocate(std::size_t size, std::size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *pointer, std::size_t size, std::size_t alignment) override
+    {
+        bytes -= size;
+        std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST_CASE("make_rc_pmr")
+{
+    SUBCASE("Allocates from the memory resource")
+    {
+        MemoryGuard guard;
+        CountingResource resource;
+
+        {
+            auto rc = make_rc_pmr<InstanceCounter>(&resource, 5);
+            REQUIRE(rc->value == 5);
+            REQUIRE_INSTANCES(1);
+            REQUIRE(resource.allocations == 1);
+            REQUIRE(resource.bytes > 0);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(resource.bytes == 0);
+    }
+
+    SUBCASE("Weak returns the memory to the resource")
+    {
+        MemoryGuard guard;
+        CountingResource resource;
+
+        Weak<InstanceCounter> weak;
+        {
+            auto rc = make_rc_pmr<InstanceCounter>(&resource);
+            weak = rc;
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(resource.bytes > 0);
+
+        weak.reset();
+        REQUIRE(resource.bytes == 0);
+    }
+
+    SUBCASE("Prc created from a pmr Rc returns the memory to the resource")
+    {
+        MemoryGuard guard;
+        CountingResource resource;
+
+        Pweak<Base> weak;
+        {
+            Prc<Base> prc = static_pointer_cast<Base>(make_rc_pmr<InstanceCounter>(&resource));
+            REQUIRE(!prc->isBase());
+            weak = prc;
+
+            auto prcDirect = make_prc_pmr<InstanceCounter>(&resource);
+            REQUIRE(resource.allocations == 2);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+        REQUIRE(resource.bytes > 0);
+
+        weak.reset();
+        REQUIRE(resource.bytes == 0);
+    }
+
+    SUBCASE("Allocator-aware content uses the memory resource")
+    {
+        MemoryGuard guard;
+        CountingResource resource;
+
+        {
+            auto rc = make_rc_pmr<std::pmr::vector<int>>(&resource, 100, 1);
+            REQUIRE(rc->size() == 100);
+            REQUIRE(rc->get_allocator().resource() == &resource);
+            REQUIRE(resource.allocations == 2);
+        }
+        REQUIRE(resource.bytes == 0);
+    }
+
+    SUBCASE("Can be backed by a monotonic buffer")
+    {
+        MemoryGuard guard;
+
+        alignas(std::max_align_t) char buffer[1024];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+        {
+            auto first = make_rc_pmr<InstanceCounter>(&arena, 1);
+            auto second = make_rc_pmr<InstanceCounter>(&arena, 2);
+
+            REQUIRE(static_cast<void *>(&*first) >= static_cast<void *>(buffer));
+            REQUIRE(static_cast<void *>(&*first) < static_cast<void *>(buffer + sizeof(buffer)));
+            REQUIRE(first->value == 1);
+            REQUIRE(second->value == 2);
+            REQUIRE_INSTANCES(2);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+}
@@ -0,0 +1,144 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/pool.h>
+#include <rcpp/prc.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Rcpp;
+
+struct Node {
+    Node(int value)
+        : value(value)
+    {
+    }
+
+    int value;
+    Rc<Node> next;
+};
+
+TEST_CASE("make_rc_pooled")
+{
+    SUBCASE("Creates and destroys the value")
+    {
+        MemoryGuard guard;
+
+        {
+            auto rc = make_rc_pooled<InstanceCounter>(5);
+            REQUIRE(rc->value == 5);
+            REQUIRE_INSTANCES(1);
+            REQUIRE(RcPool<InstanceCounter>::blocksInUse() == 1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(RcPool<InstanceCounter>::blocksInUse() == 0);
+
+        RcPool<InstanceCounter>::trim();
+    }
+
+    SUBCASE("Reuses freed blocks")
+    {
+        MemoryGuard guard;
+
+        void *firstAddress;
+        {
+            auto rc = make_rc_pooled<Node>(1);
+            firstAddress = &*rc;
+        }
+        auto rc = make_rc_pooled<Node>(2);
+        REQUIRE(&*rc == firstAddress);
+        REQUIRE(RcPool<Node>::slabs() == 1);
+
+        rc.reset();
+        RcPool<Node>::trim();
+    }
+
+    SUBCASE("Keeps the block as long as a weak reference exists")
+    {
+        MemoryGuard guard;
+
+        Weak<InstanceCounter> weak;
+        {
+            auto rc = make_rc_pooled<InstanceCounter>();
+            weak = rc;
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+        REQUIRE(RcPool<InstanceCounter>::blocksInUse() == 1);
+
+        weak.reset();
+        REQUIRE(RcPool<InstanceCounter>::blocksInUse() == 0);
+        RcPool<InstanceCounter>::trim();
+    }
+
+    SUBCASE("Works with Prc")
+    {
+        MemoryGuard guard;
+
+        {
+            Prc<Base> prc = static_pointer_cast<Base>(make_rc_pooled<InstanceCounter>());
+            REQUIRE(!prc->isBase());
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(RcPool<InstanceCounter>::blocksInUse() == 0);
+        RcPool<InstanceCounter>::trim();
+    }
+
+    SUBCASE("Trim only releases empty slabs")
+    {
+        MemoryGuard guard;
+
+        const auto count = RcPool<Node>::BlocksPerSlab * 4;
+        std::vector<Rc<Node>> nodes;
+        for (std::size_t i = 0; i < count; ++i) {
+            nodes.push_back(make_rc_pooled<Node>(static_cast<int>(i)));
+        }
+        const auto slabs = RcPool<Node>::slabs();
+        REQUIRE(slabs >= 2);
+        REQUIRE(RcPool<Node>::trim() == 0);
+
+        // Keep a single node alive, so exactly one slab stays in use.
+        auto survivor = nodes.front();
+        nodes.clear();
+        REQUIRE(RcPool<Node>::blocksInUse() == 1);
+        REQUIRE(RcPool<Node>::trim() == slabs - 1);
+        REQUIRE(RcPool<Node>::slabs() == 1);
+        REQUIRE(survivor->value == 0);
+
+        survivor.reset();
+        REQUIRE(RcPool<Node>::trim() == 1);
+        REQUIRE(RcPool<Node>::slabs() == 0);
+    }
+
+    SUBCASE("Can be used from multiple threads at the same time")
+    {
+        MemoryGuard guard;
+
+        auto work = [] {
+            for (int round = 0; round < 100; ++round) {
+                std::vector<Rc<Node>> nodes;
+                for (int i = 0; i < 100; ++i) {
+                    nodes.push_back(make_rc_pooled<Node>(i));
+                }
+            }
+        };
+        std::thread first(work);
+        std::thread second(work);
+        first.join();
+        second.join();
+
+        // a node created on this thread can be released on another one
+        auto node = make_rc_pooled<Node>(1);
+        std::thread([node = std::move(node)]() mutable { node.reset(); }).join();
+
+        REQUIRE(RcPool<Node>::blocksInUse() == 0);
+        RcPool<Node>::trim();
+        REQUIRE(RcPool<Node>::slabs() == 0);
+    }
+}
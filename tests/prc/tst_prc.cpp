@@ -10,6 +10,25 @@
 
 using namespace Rcpp;
 
+template<typename Derived, typename Base, typename = void>
+struct CanDynamicBaseCast : std::false_type {
+};
+
+template<typename Derived, typename Base>
+struct CanDynamicBaseCast<Derived, Base, std::void_t<decltype(dynamic_base_pointer_cast<Derived>(std::declval<const Prc<Base> &>()))>> : std::true_type {
+};
+
+struct PlainBase {
+};
+
+struct PlainDerived : public PlainBase {
+    int value = 0;
+};
+
+// typeid only knows the static type of a non-polymorphic base, so the cast is not available
+static_assert(CanDynamicBaseCast<InstanceCounter, Base>::value);
+static_assert(!CanDynamicBaseCast<PlainDerived, PlainBase>::value);
+static_assert(!CanDynamicBaseCast<PlainBase, PlainBase>::value);
 
 TEST_CASE("Prc")
 {
@@ -229,4 +248,107 @@ TEST_CASE("Prc casting")
         }
         REQUIRE_INSTANCES(0);
     }
+
+    SUBCASE("A Prc can be moved into a Rc if the type matches exactly")
+    {
+        MemoryGuard guard;
+
+        REQUIRE_INSTANCES(0);
+        {
+            auto prc = static_pointer_cast<Base>(make_prc<InstanceCounter>(5));
+
+            Rc<Base> baseRc = dynamic_base_pointer_cast<Base>(std::move(prc));
+            REQUIRE(!baseRc);
+            REQUIRE(prc);
+
+            Rc<InstanceCounter> rc = dynamic_base_pointer_cast<InstanceCounter>(std::move(prc));
+            REQUIRE(rc);
+            REQUIRE(!prc);
+            REQUIRE(rc->value == 5);
+
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("Prc with over-aligned values")
+{
+    struct alignas(64) OverAligned : public InstanceCounter {
+    };
+
+    MemoryGuard guard;
+    {
+        Prc<Base> prc = static_pointer_cast<Base>(make_rc<OverAligned>());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(&*dynamic_pointer_cast<OverAligned>(prc)) % 64 == 0);
+        REQUIRE_INSTANCES(1);
+    }
+    REQUIRE_INSTANCES(0);
+}
+
+TEST_CASE("Prc with separately stored values")
+{
+    struct Large : public InstanceCounter {
+        char data[2048];
+    };
+
+    MemoryGuard guard;
+    {
+        Prc<Base> prc = static_pointer_cast<Base>(make_rc<Large>());
+        auto copy = prc;
+        REQUIRE(!copy->isBase());
+        REQUIRE(dynamic_base_pointer_cast<Large>(copy));
+        REQUIRE_INSTANCES(1);
+    }
+    REQUIRE_INSTANCES(0);
+}
+
+TEST_CASE("get_mut for Prc")
+{
+    MemoryGuard guard;
+
+    Prc<Base> prc = static_pointer_cast<Base>(make_rc<InstanceCounter>());
+    REQUIRE(get_mut(prc) == &*prc);
+    {
+        auto other = prc;
+        REQUIRE(!get_mut(prc));
+    }
+    REQUIRE(get_mut(prc));
+}
+
+struct PrcChain : public InstanceCounter {
+    Prc<Base> next;
+};
+
+Prc<Base> makePrcChain(int length)
+{
+    Prc<Base> head;
+    for (int i = 0; i < length; ++i) {
+        auto node = make_rc<PrcChain>();
+        node->next = std::move(head);
+        head = static_pointer_cast<Base>(node);
+    }
+    return head;
+}
+
+TEST_CASE("Prc releases go through the drop queue")
+{
+    SUBCASE("Releases are deferred")
+    {
+        MemoryGuard guard;
+        RcDeferredDrops deferred;
+
+        makePrcChain(3);
+        REQUIRE_INSTANCES(3);
+        REQUIRE(pending_drops() == 1);
+        REQUIRE(drain_drops(10) == 3);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Destroying a long chain does not overflow the stack")
+    {
+        MemoryGuard guard;
+        makePrcChain(1000000);
+        REQUIRE_INSTANCES(0);
+    }
 }
@@ -1,4 +1,5 @@
 
+#include <cstdint>
 #include <type_traits>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
@@ -109,3 +110,21 @@ TEST_CASE("Weak")
         }
     }
 }
+
+TEST_CASE("Pweak with a custom counter type")
+{
+    MemoryGuard guard;
+
+    Pweak<Base, std::uint32_t> weak;
+    {
+        Prc<Base, std::uint32_t> prc = static_pointer_cast<Base>(Rc<InstanceCounter, std::uint32_t>::make());
+        weak = prc;
+        REQUIRE(!weak.lock()->isBase());
+
+        Rc<InstanceCounter, std::uint32_t> rc = dynamic_base_pointer_cast<InstanceCounter>(weak.lock());
+        REQUIRE(rc);
+        REQUIRE_INSTANCES(1);
+    }
+    REQUIRE_INSTANCES(0);
+    REQUIRE(!weak.lock());
+}
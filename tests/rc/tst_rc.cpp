@@ -3,7 +3,17 @@
 #include <doctest.h>
 
 #include <rcpp/rc.h>
+#include <rcpp/weak.h>
 
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#include <common/CountingAllocator.h>
 #include <common/InstanceCounter.h>
 #include <common/MemoryGuard.h>
 
@@ -12,6 +22,37 @@ using namespace Rcpp;
 #define REQUIRE_INSTANCES(X) REQUIRE(InstanceCounter::instances == (X));
 
 static_assert(sizeof(Rc<int>) == sizeof(void *));
+// the control block only consists of the two counters
+static_assert(sizeof(RcValue<std::size_t, std::size_t>) == 3 * sizeof(std::size_t));
+// smaller counters shrink the control block
+static_assert(sizeof(RcValue<std::uint32_t, std::uint32_t>) == 3 * sizeof(std::uint32_t));
+static_assert(sizeof(RcValue<std::uint16_t, std::uint16_t>) == 3 * sizeof(std::uint16_t));
+// stateless allocators are not stored, only the function that frees the block
+static_assert(sizeof(RcAllocatedValue<std::size_t, std::size_t, std::allocator<std::size_t>>::Block) == sizeof(RcValue<std::size_t, std::size_t>) + sizeof(void *));
+
+struct Large : public InstanceCounter {
+    using InstanceCounter::InstanceCounter;
+
+    char data[2048];
+};
+
+// a small type that is explicitly stored separately
+struct SeparateSmall : public InstanceCounter {
+};
+
+template<>
+struct Rcpp::RcSeparateContent<SeparateSmall> : std::true_type {
+};
+
+// large values only keep a pointer to their content in the control block
+static_assert(RcValue<Large, std::size_t>::SeparateContent);
+static_assert(sizeof(RcValue<Large, std::size_t>) == 3 * sizeof(std::size_t));
+static_assert(!RcValue<InstanceCounter, std::size_t>::SeparateContent);
+
+// Rc can still refer to incomplete types
+struct Node {
+    Rc<Node> next;
+};
 
 TEST_CASE("Rc")
 {
@@ -107,3 +148,593 @@ TEST_CASE("Rc")
         REQUIRE(secondRc->value == 10);
     }
 }
+
+TEST_CASE("allocate_rc")
+{
+    SUBCASE("Allocates and frees the value with the allocator")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        {
+            auto rc = allocate_rc<InstanceCounter>(CountingAllocator<InstanceCounter>(stats), 5);
+            REQUIRE(rc->value == 5);
+            REQUIRE_INSTANCES(1);
+            REQUIRE(stats.allocations == 1);
+            REQUIRE(stats.live() == 1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("Keeps the memory alive as long as a weak reference exists")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        Weak<InstanceCounter> weak;
+        {
+            auto rc = allocate_rc<InstanceCounter>(CountingAllocator<InstanceCounter>(stats));
+            weak = rc;
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+        REQUIRE(stats.live() == 1);
+
+        weak.reset();
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("std::allocator allocates like make_rc")
+    {
+        MemoryGuard guard;
+
+        {
+            auto rc = allocate_rc<InstanceCounter>(std::allocator<InstanceCounter>(), 5);
+            Weak<InstanceCounter> weak = rc;
+            REQUIRE(rc->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Frees the memory if the constructor throws")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        struct Throwing {
+            Throwing()
+            {
+                throw 42;
+            }
+        };
+
+        REQUIRE_THROWS_AS(allocate_rc<Throwing>(CountingAllocator<Throwing>(stats)), int);
+        REQUIRE(stats.allocations == 1);
+        REQUIRE(stats.live() == 0);
+    }
+}
+
+TEST_CASE("Rc with a custom counter type")
+{
+    SUBCASE("Counts references like the default counter")
+    {
+        MemoryGuard guard;
+
+        Weak<InstanceCounter, std::uint16_t> weak;
+        {
+            auto rc = Rc<InstanceCounter, std::uint16_t>::make(5);
+            auto copy = rc;
+            weak = copy;
+
+            REQUIRE(weak.lock()->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Supports the maximum number of references")
+    {
+        MemoryGuard guard;
+
+        auto rc = Rc<int, std::uint8_t>::make(5);
+        // keep room for the Rc created by lock()
+        std::vector<Rc<int, std::uint8_t>> strong(253, rc);
+        // the implicit weak reference of the strong references counts as well
+        // the two lowest bits of the weak count are flags
+        std::vector<Weak<int, std::uint8_t>> weak;
+        weak.reserve(62);
+        for (int i = 0; i < 62; ++i) {
+            weak.emplace_back(rc);
+        }
+
+        REQUIRE(*weak.back().lock() == 5);
+        strong.clear();
+        weak.clear();
+        REQUIRE(*rc == 5);
+    }
+
+    SUBCASE("Can be allocated with an allocator")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        {
+            auto rc = Rc<InstanceCounter, std::uint32_t>::allocate(CountingAllocator<InstanceCounter>(stats), 5);
+            REQUIRE(rc->value == 5);
+            REQUIRE(stats.live() == 1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(stats.live() == 0);
+    }
+}
+
+TEST_CASE("Rc with separately stored values")
+{
+    SUBCASE("Frees the value with the last strong reference")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        Weak<Large> weak;
+        {
+            auto rc = allocate_rc<Large>(CountingAllocator<Large>(stats), 5);
+            weak = rc;
+            REQUIRE(weak.lock()->value == 5);
+            REQUIRE(stats.live() == 2);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+        // only the control block is left
+        REQUIRE(stats.live() == 1);
+
+        weak.reset();
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("Are created by make_rc")
+    {
+        MemoryGuard guard;
+
+        Weak<Large> weak;
+        {
+            auto rc = make_rc<Large>(5);
+            weak = rc;
+            auto copy = weak.lock();
+            REQUIRE(copy->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Can be chosen explicitly")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        {
+            auto rc = allocate_rc<SeparateSmall>(CountingAllocator<SeparateSmall>(stats));
+            REQUIRE(stats.live() == 2);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("Frees the memory if the constructor throws")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        struct Throwing {
+            Throwing()
+            {
+                throw 42;
+            }
+
+            char data[2048];
+        };
+
+        REQUIRE_THROWS_AS(allocate_rc<Throwing>(CountingAllocator<Throwing>(stats)), int);
+        REQUIRE(stats.allocations == 2);
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("Supports incomplete types")
+    {
+        MemoryGuard guard;
+
+        auto first = make_rc<Node>();
+        first->next = make_rc<Node>();
+        REQUIRE(first->next);
+        REQUIRE(!first->next->next);
+    }
+}
+
+TEST_CASE("make_mut")
+{
+    SUBCASE("Returns the value in place if the Rc is unique")
+    {
+        MemoryGuard guard;
+
+        const auto copies = InstanceCounter::copies;
+        auto rc = make_rc<InstanceCounter>(1);
+        auto *value = &*rc;
+
+        make_mut(rc).value = 2;
+        REQUIRE(&*rc == value);
+        REQUIRE(rc->value == 2);
+        REQUIRE(InstanceCounter::copies == copies);
+    }
+
+    SUBCASE("Copies a shared value")
+    {
+        MemoryGuard guard;
+        {
+            const auto copies = InstanceCounter::copies;
+            auto rc = make_rc<InstanceCounter>(1);
+            auto other = rc;
+
+            make_mut(rc).value = 2;
+            REQUIRE(&*rc != &*other);
+            REQUIRE(rc->value == 2);
+            REQUIRE(other->value == 1);
+            REQUIRE(InstanceCounter::copies == copies + 1);
+            REQUIRE_INSTANCES(2);
+
+            // the copy is unique now
+            auto *value = &*rc;
+            make_mut(rc);
+            REQUIRE(&*rc == value);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Disassociates weak references from a unique value")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc<std::vector<int>>(1000, 1);
+            Weak<std::vector<int>> weak = rc;
+            const auto *data = rc->data();
+
+            auto &vector = make_mut(rc);
+            // the value was moved, not copied
+            REQUIRE(vector.data() == data);
+            vector.push_back(2);
+            REQUIRE(rc->size() == 1001);
+            REQUIRE(!weak.lock());
+        }
+    }
+}
+
+TEST_CASE("Ownership recovery")
+{
+    SUBCASE("try_unwrap moves the value out of a unique Rc")
+    {
+        MemoryGuard guard;
+        {
+            const auto copies = InstanceCounter::copies;
+            auto rc = make_rc<InstanceCounter>(5);
+            Weak<InstanceCounter> weak = rc;
+
+            auto value = try_unwrap(std::move(rc));
+            REQUIRE(value);
+            REQUIRE(value->value == 5);
+            REQUIRE(!rc);
+            REQUIRE(!weak.lock());
+            REQUIRE(InstanceCounter::copies == copies);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("try_unwrap leaves a shared Rc unchanged")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc<InstanceCounter>(5);
+        auto other = rc;
+
+        REQUIRE(!try_unwrap(std::move(rc)));
+        REQUIRE(rc);
+        REQUIRE(&*rc == &*other);
+    }
+
+    SUBCASE("into_inner returns the value of the last strong reference")
+    {
+        MemoryGuard guard;
+        {
+            const auto copies = InstanceCounter::copies;
+            auto rc = make_rc<InstanceCounter>(5);
+            auto other = rc;
+
+            REQUIRE(!into_inner(std::move(rc)));
+            REQUIRE(!rc);
+            REQUIRE_INSTANCES(1);
+
+            auto value = into_inner(std::move(other));
+            REQUIRE(value->value == 5);
+            REQUIRE(InstanceCounter::copies == copies);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("unwrap_or_clone only copies shared values")
+    {
+        MemoryGuard guard;
+        {
+            const auto copies = InstanceCounter::copies;
+            auto rc = make_rc<InstanceCounter>(5);
+            auto other = rc;
+
+            auto copy = unwrap_or_clone(std::move(rc));
+            REQUIRE(InstanceCounter::copies == copies + 1);
+            REQUIRE(!rc);
+
+            auto moved = unwrap_or_clone(std::move(other));
+            REQUIRE(moved.value == 5);
+            REQUIRE(InstanceCounter::copies == copies + 1);
+            REQUIRE_INSTANCES(2);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("get_mut only returns the value of a unique Rc")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc<InstanceCounter>(5);
+        REQUIRE(get_mut(rc) == &*rc);
+        {
+            auto other = rc;
+            REQUIRE(!get_mut(rc));
+        }
+        {
+            Weak<InstanceCounter> weak = rc;
+            REQUIRE(!get_mut(rc));
+        }
+        get_mut(rc)->value = 6;
+        REQUIRE(rc->value == 6);
+
+        Rc<InstanceCounter> empty;
+        REQUIRE(!get_mut(empty));
+    }
+}
+
+TEST_CASE("reuse_or_make")
+{
+    SUBCASE("Reuses the memory of a unique Rc")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+        {
+            auto rc = allocate_rc<InstanceCounter>(CountingAllocator<InstanceCounter>(stats), 1);
+            auto *value = &*rc;
+
+            auto replaced = Rc<InstanceCounter>::reuse_or_make(std::move(rc), 2);
+            REQUIRE(!rc);
+            REQUIRE(&*replaced == value);
+            REQUIRE(replaced->value == 2);
+            REQUIRE(stats.allocations == 1);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(stats.live() == 0);
+    }
+
+    SUBCASE("Creates a new value if the Rc is shared")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc<InstanceCounter>(1);
+            auto other = rc;
+            Weak<InstanceCounter> weak = make_rc<InstanceCounter>(3);
+
+            auto replaced = Rc<InstanceCounter>::reuse_or_make(std::move(rc), 2);
+            REQUIRE(!rc);
+            REQUIRE(&*replaced != &*other);
+            REQUIRE(other->value == 1);
+            REQUIRE(replaced->value == 2);
+            REQUIRE_INSTANCES(2);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Creates a new value if a Weak refers to the old one")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc<InstanceCounter>(1);
+            Weak<InstanceCounter> weak = rc;
+
+            auto replaced = Rc<InstanceCounter>::reuse_or_make(std::move(rc), 2);
+            REQUIRE(!weak.lock());
+            REQUIRE(replaced->value == 2);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Releases the memory if the constructor throws")
+    {
+        MemoryGuard guard;
+        AllocationStats stats;
+
+        struct MaybeThrowing {
+            MaybeThrowing(bool shouldThrow)
+            {
+                if (shouldThrow) {
+                    throw 42;
+                }
+            }
+        };
+
+        auto rc = allocate_rc<MaybeThrowing>(CountingAllocator<MaybeThrowing>(stats), false);
+        REQUIRE_THROWS_AS(Rc<MaybeThrowing>::reuse_or_make(std::move(rc), true), int);
+        REQUIRE(!rc);
+        REQUIRE(stats.live() == 0);
+    }
+}
+
+struct Chain : public InstanceCounter {
+    Rc<Chain> next;
+};
+
+Rc<Chain> makeChain(int length)
+{
+    Rc<Chain> head;
+    for (int i = 0; i < length; ++i) {
+        auto node = make_rc<Chain>();
+        node->next = std::move(head);
+        head = std::move(node);
+    }
+    return head;
+}
+
+TEST_CASE("Deferred drops")
+{
+    SUBCASE("Values are destroyed immediately by default")
+    {
+        MemoryGuard guard;
+        makeChain(3);
+        REQUIRE_INSTANCES(0);
+        REQUIRE(pending_drops() == 0);
+    }
+
+    SUBCASE("drain_drops destroys at most the given number of values")
+    {
+        MemoryGuard guard;
+        RcDeferredDrops deferred;
+
+        makeChain(5);
+        REQUIRE_INSTANCES(5);
+        REQUIRE(pending_drops() == 1);
+
+        // each destroyed value queues the next one in the chain
+        REQUIRE(drain_drops(2) == 2);
+        REQUIRE_INSTANCES(3);
+        REQUIRE(drain_drops(10) == 3);
+        REQUIRE_INSTANCES(0);
+        REQUIRE(drain_drops(10) == 0);
+    }
+
+    SUBCASE("drain_drops with a time slice destroys at least a few values")
+    {
+        MemoryGuard guard;
+        RcDeferredDrops deferred;
+
+        makeChain(20);
+        REQUIRE(drain_drops(std::chrono::nanoseconds(0)) == 16);
+        REQUIRE_INSTANCES(4);
+        REQUIRE(drain_drops(std::chrono::seconds(10)) == 4);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Queued values can not be locked")
+    {
+        MemoryGuard guard;
+        RcDeferredDrops deferred;
+
+        auto rc = make_rc<InstanceCounter>(1);
+        Weak<InstanceCounter> weak = rc;
+        rc.reset();
+        REQUIRE_INSTANCES(1);
+        REQUIRE(!weak.lock());
+
+        drain_drops(1);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("The last scope destroys the remaining values")
+    {
+        MemoryGuard guard;
+        {
+            RcDeferredDrops outer;
+            {
+                RcDeferredDrops inner;
+                makeChain(3);
+            }
+            REQUIRE_INSTANCES(3);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(pending_drops() == 0);
+    }
+
+    SUBCASE("Values released after the queue of the thread is destroyed are destroyed right away")
+    {
+        struct Holder {
+            Rc<Chain> chain;
+        };
+
+        MemoryGuard guard;
+        std::thread([] {
+            // constructed before the drop queue of the thread, so it is destroyed after it
+            static thread_local Holder holder;
+            holder.chain = makeChain(100);
+
+            RcDeferredDrops deferred;
+            makeChain(3);
+        }).join();
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+struct ListNode {
+    Rc<ListNode> next;
+};
+
+// Runs f on a thread with a small stack, where available.
+template<typename F>
+void runWithSmallStack(F f)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, 256 * 1024);
+    pthread_t thread;
+    const auto run = [](void *function) -> void * {
+        (*static_cast<F *>(function))();
+        return nullptr;
+    };
+    REQUIRE(pthread_create(&thread, &attributes, run, &f) == 0);
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+#else
+    f();
+#endif
+}
+
+TEST_CASE("Destroying long chains")
+{
+    SUBCASE("Does not overflow the stack")
+    {
+        MemoryGuard guard;
+        bool finished = false;
+        runWithSmallStack([&] {
+            Rc<ListNode> head;
+            for (int i = 0; i < 10'000'000; ++i) {
+                auto node = make_rc<ListNode>();
+                node->next = std::move(head);
+                head = std::move(node);
+            }
+            head.reset();
+            finished = true;
+        });
+        REQUIRE(finished);
+    }
+
+    SUBCASE("Destroys all values beyond the recursion limit")
+    {
+        MemoryGuard guard;
+        {
+            auto head = makeChain(1000);
+            REQUIRE_INSTANCES(1000);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(pending_drops() == 0);
+    }
+}
@@ -0,0 +1,151 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/rc_array.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace Rcpp;
+
+static_assert(sizeof(Rc<int[]>) == sizeof(void *));
+// the control block only holds the counts and the length, the elements follow it
+static_assert(sizeof(RcValue<int[], std::size_t>) == 3 * sizeof(std::size_t));
+
+TEST_CASE("Rc<T[]>")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        Rc<int[]> rc;
+        REQUIRE(!rc);
+        REQUIRE(rc.size() == 0);
+        REQUIRE(rc.begin() == rc.end());
+    }
+
+    SUBCASE("Value-initializes its elements")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_array<int>(100);
+        REQUIRE(rc.size() == 100);
+        REQUIRE(std::accumulate(rc.begin(), rc.end(), 0) == 0);
+
+        rc[5] = 5;
+        REQUIRE(rc.data()[5] == 5);
+    }
+
+    SUBCASE("Can be filled with a value")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_array<std::string>(3, "abc");
+        for (const auto &element : rc) {
+            REQUIRE(element == "abc");
+        }
+    }
+
+    SUBCASE("Can be created from a range")
+    {
+        MemoryGuard guard;
+
+        const std::vector<int> values = { 1, 2, 3, 4 };
+        auto rc = make_rc_array_from<int>(values);
+        REQUIRE(std::vector<int>(rc.begin(), rc.end()) == values);
+
+        auto fromIterators = Rc<int[]>::from_range(values.begin() + 1, values.end());
+        REQUIRE(fromIterators.size() == 3);
+        REQUIRE(fromIterators[0] == 2);
+    }
+
+    SUBCASE("Destructs its elements with the last strong reference")
+    {
+        MemoryGuard guard;
+
+        Weak<InstanceCounter[]> weak;
+        {
+            auto rc = make_rc_array<InstanceCounter>(10);
+            auto copy = rc;
+            weak = copy;
+            REQUIRE_INSTANCES(10);
+            REQUIRE(weak.lock().size() == 10);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Aligns its elements")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_array<float, 64>(17);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(rc.data()) % 64 == 0);
+
+        auto large = make_rc_array_for_overwrite<float, 256>(1024);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(large.data()) % 256 == 0);
+        large[1023] = 1.f;
+        REQUIRE(large.end()[-1] == 1.f);
+    }
+
+    SUBCASE("Provides a span of its elements")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_array<int, 32>(4, 7);
+        RcSpan<int> span = rc.span();
+        REQUIRE(span.data() == rc.data());
+        REQUIRE(span.size() == 4);
+        span[3] = 1;
+        REQUIRE(rc[3] == 1);
+
+        REQUIRE(Rc<int[]>().span().empty());
+    }
+
+    SUBCASE("Supports empty arrays")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_array<InstanceCounter>(0);
+        REQUIRE(rc);
+        REQUIRE(rc.empty());
+    }
+
+    SUBCASE("Frees the memory if an element constructor throws")
+    {
+        MemoryGuard guard;
+
+        struct Throwing : public InstanceCounter {
+            Throwing()
+            {
+                if (instances > 3) {
+                    throw 42;
+                }
+            }
+        };
+
+        REQUIRE_THROWS_AS(make_rc_array<Throwing>(10), int);
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("Rc<T[]> releases are deferred")
+{
+    MemoryGuard guard;
+    {
+        RcDeferredDrops deferred;
+
+        make_rc_array<InstanceCounter>(4);
+        REQUIRE_INSTANCES(4);
+        REQUIRE(pending_drops() == 1);
+        REQUIRE(drain_drops(1) == 1);
+        REQUIRE_INSTANCES(0);
+    }
+    REQUIRE(pending_drops() == 0);
+}
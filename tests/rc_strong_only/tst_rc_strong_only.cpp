@@ -0,0 +1,88 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/rc_strong_only.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <cstdint>
+#include <type_traits>
+
+using namespace Rcpp;
+
+static_assert(sizeof(RcStrongOnly<int>) == sizeof(void *));
+// only the strong count is stored
+static_assert(sizeof(RcStrongValue<std::size_t, std::size_t>) == 2 * sizeof(std::size_t));
+static_assert(sizeof(RcStrongValue<std::uint32_t, std::uint32_t>) == 2 * sizeof(std::uint32_t));
+static_assert(!std::is_constructible_v<Weak<int>, RcStrongOnly<int>>, "A Weak must not be created from an RcStrongOnly");
+
+TEST_CASE("RcStrongOnly")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        RcStrongOnly<int> rc;
+        REQUIRE(!rc);
+    }
+
+    SUBCASE("A single RcStrongOnly destructs the reference counted entity")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc_strong_only<InstanceCounter>(5);
+            REQUIRE(rc->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Can be copied and moved")
+    {
+        MemoryGuard guard;
+        {
+            RcStrongOnly<InstanceCounter> rc;
+            {
+                auto second = make_rc_strong_only<InstanceCounter>();
+                RcStrongOnly<InstanceCounter> third(second); // copy construction
+                rc = second; // copy assignment
+
+                RcStrongOnly<InstanceCounter> fourth(std::move(third)); // move construction
+                REQUIRE(!third);
+                REQUIRE(fourth);
+                REQUIRE(&*fourth == &*rc);
+                REQUIRE_INSTANCES(1);
+            }
+            REQUIRE(rc);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Supports custom counter types")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = RcStrongOnly<InstanceCounter, std::uint16_t>::make(3);
+            auto copy = rc;
+            rc.reset();
+            REQUIRE(copy->value == 3);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("RcStrongOnly releases are deferred")
+{
+    MemoryGuard guard;
+    RcDeferredDrops deferred;
+
+    make_rc_strong_only<InstanceCounter>(1);
+    REQUIRE_INSTANCES(1);
+    REQUIRE(pending_drops() == 1);
+    REQUIRE(drain_drops(1) == 1);
+    REQUIRE_INSTANCES(0);
+}
@@ -0,0 +1,116 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/rc_trailing.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <cstdint>
+#include <string>
+
+using namespace Rcpp;
+
+struct NodeHeader {
+    NodeHeader(std::string name)
+        : name(std::move(name))
+    {
+    }
+
+    std::string name;
+};
+
+using Node = RcTrailing<NodeHeader, int>;
+
+static_assert(sizeof(Rc<Node>) == sizeof(void *));
+
+TEST_CASE("make_rc_with_trailing")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        Rc<Node> rc;
+        REQUIRE(!rc);
+        REQUIRE(rc.trailing().empty());
+    }
+
+    SUBCASE("Constructs the header and the elements")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_with_trailing<NodeHeader, int>(4, "node");
+        REQUIRE(rc->name == "node");
+        REQUIRE((*rc).name == "node");
+
+        auto elements = rc.trailing();
+        REQUIRE(elements.size() == 4);
+        for (int element : elements) {
+            REQUIRE(element == 0);
+        }
+        elements[3] = 3;
+        REQUIRE(rc.trailing()[3] == 3);
+    }
+
+    SUBCASE("Destructs the header and elements with the last strong reference")
+    {
+        MemoryGuard guard;
+
+        Weak<RcTrailing<InstanceCounter, InstanceCounter>> weak;
+        {
+            auto rc = make_rc_with_trailing<InstanceCounter, InstanceCounter>(3, 5);
+            auto copy = rc;
+            weak = copy;
+            REQUIRE(weak.lock()->value == 5);
+            REQUIRE_INSTANCES(4);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Aligns the elements")
+    {
+        MemoryGuard guard;
+
+        auto rc = make_rc_with_trailing<NodeHeader, float, 64>(16, "aligned");
+        REQUIRE(reinterpret_cast<std::uintptr_t>(rc.trailing().data()) % 64 == 0);
+        REQUIRE(reinterpret_cast<const char *>(&*rc) < reinterpret_cast<const char *>(rc.trailing().data()));
+    }
+
+    SUBCASE("Frees the memory if a constructor throws")
+    {
+        MemoryGuard guard;
+
+        struct ThrowingHeader {
+            ThrowingHeader()
+            {
+                throw 42;
+            }
+        };
+        REQUIRE_THROWS_AS((make_rc_with_trailing<ThrowingHeader, int>(4)), int);
+
+        struct ThrowingElement : public InstanceCounter {
+            ThrowingElement()
+            {
+                if (instances > 3) {
+                    throw 42;
+                }
+            }
+        };
+        REQUIRE_THROWS_AS((make_rc_with_trailing<InstanceCounter, ThrowingElement>(10)), int);
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("make_rc_with_trailing releases are deferred")
+{
+    MemoryGuard guard;
+    RcDeferredDrops deferred;
+
+    make_rc_with_trailing<InstanceCounter, InstanceCounter>(3, 5);
+    REQUIRE_INSTANCES(4);
+    REQUIRE(pending_drops() == 1);
+    REQUIRE(drain_drops(1) == 1);
+    REQUIRE_INSTANCES(0);
+}
@@ -0,0 +1,117 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/uninit.h>
+#include <rcpp/weak.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace Rcpp;
+
+TEST_CASE("RcUninit")
+{
+    SUBCASE("Frees the memory without destructing a value")
+    {
+        MemoryGuard guard;
+
+        auto uninit = make_rc_uninit<InstanceCounter>();
+        REQUIRE(uninit);
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Can be initialized by writing to its memory")
+    {
+        MemoryGuard guard;
+
+        using Buffer = std::array<std::uint32_t, 16>;
+        const Buffer source = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+        auto uninit = make_rc_uninit<Buffer>();
+        auto *data = uninit.data();
+        std::memcpy(data, source.data(), sizeof(source));
+
+        auto rc = RcUninit<Buffer>::assume_init(std::move(uninit));
+        REQUIRE(!uninit);
+        REQUIRE(&*rc == data);
+        REQUIRE(*rc == source);
+    }
+
+    SUBCASE("Can be initialized by constructing the value")
+    {
+        MemoryGuard guard;
+        {
+            auto uninit = make_rc_uninit<InstanceCounter>();
+            auto rc = RcUninit<InstanceCounter>::emplace(std::move(uninit), 5);
+            Weak<InstanceCounter> weak = rc;
+
+            REQUIRE(weak.lock()->value == 5);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Frees the memory if the constructor throws")
+    {
+        MemoryGuard guard;
+
+        struct Throwing {
+            Throwing()
+            {
+                throw 42;
+            }
+        };
+
+        auto uninit = make_rc_uninit<Throwing>();
+        REQUIRE_THROWS_AS(RcUninit<Throwing>::emplace(std::move(uninit)), int);
+        REQUIRE(uninit);
+    }
+
+    SUBCASE("Supports separately stored values")
+    {
+        MemoryGuard guard;
+
+        using Large = std::array<char, 4096>;
+        auto uninit = make_rc_uninit<Large>();
+        std::memset(uninit.data(), 'a', sizeof(Large));
+
+        auto rc = RcUninit<Large>::assume_init(std::move(uninit));
+        REQUIRE(rc->back() == 'a');
+    }
+}
+
+TEST_CASE("make_rc_for_overwrite")
+{
+    SUBCASE("Default-initializes the value")
+    {
+        MemoryGuard guard;
+        {
+            auto rc = make_rc_for_overwrite<InstanceCounter>();
+            REQUIRE(rc->value == 0);
+            REQUIRE_INSTANCES(1);
+
+            auto buffer = make_rc_for_overwrite<std::array<float, 1024>>();
+            buffer->fill(1.f);
+            REQUIRE(buffer->front() == 1.f);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Frees the memory if the constructor throws")
+    {
+        MemoryGuard guard;
+
+        struct Throwing {
+            Throwing()
+            {
+                throw 42;
+            }
+        };
+
+        REQUIRE_THROWS_AS(make_rc_for_overwrite<Throwing>(), int);
+    }
+}
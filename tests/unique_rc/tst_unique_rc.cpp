@@ -0,0 +1,105 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <rcpp/unique_rc.h>
+
+#include <common/InstanceCounter.h>
+#include <common/MemoryGuard.h>
+
+#include <vector>
+
+using namespace Rcpp;
+
+struct TreeNode : public InstanceCounter {
+    Weak<TreeNode> parent;
+    std::vector<Rc<TreeNode>> children;
+};
+
+TEST_CASE("UniqueRc")
+{
+    SUBCASE("Can be default constructed")
+    {
+        MemoryGuard guard;
+
+        UniqueRc<int> unique;
+        REQUIRE(!unique);
+        REQUIRE(!UniqueRc<int>::into_rc(std::move(unique)));
+    }
+
+    SUBCASE("Destructs its value")
+    {
+        MemoryGuard guard;
+        {
+            auto unique = make_unique_rc<InstanceCounter>(5);
+            unique->value = 6;
+            REQUIRE((*unique).value == 6);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Weaks can only be locked after the value is shared")
+    {
+        MemoryGuard guard;
+
+        Weak<InstanceCounter> weak;
+        {
+            auto unique = make_unique_rc<InstanceCounter>(5);
+            weak = unique.downgrade();
+            REQUIRE(!weak.lock());
+
+            auto *value = &*unique;
+            auto rc = UniqueRc<InstanceCounter>::into_rc(std::move(unique));
+            REQUIRE(!unique);
+            REQUIRE(&*rc == value);
+            REQUIRE(weak.lock()->value == 5);
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Weaks of a value that is never shared can not be locked")
+    {
+        MemoryGuard guard;
+
+        Weak<InstanceCounter> weak;
+        {
+            auto unique = make_unique_rc<InstanceCounter>();
+            weak = unique.downgrade();
+        }
+        REQUIRE_INSTANCES(0);
+        REQUIRE(!weak.lock());
+    }
+
+    SUBCASE("Can build a tree with parent pointers")
+    {
+        MemoryGuard guard;
+        {
+            auto root = make_unique_rc<TreeNode>();
+            for (int i = 0; i < 3; ++i) {
+                auto child = make_rc<TreeNode>();
+                child->parent = root.downgrade();
+                root->children.push_back(child);
+            }
+            auto tree = UniqueRc<TreeNode>::into_rc(std::move(root));
+
+            for (const auto &child : tree->children) {
+                REQUIRE(&*child->parent.lock() == &*tree);
+            }
+            REQUIRE_INSTANCES(4);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+}
+
+TEST_CASE("UniqueRc releases are deferred")
+{
+    MemoryGuard guard;
+    RcDeferredDrops deferred;
+
+    make_unique_rc<InstanceCounter>(1);
+    REQUIRE_INSTANCES(1);
+    REQUIRE(pending_drops() == 1);
+    REQUIRE(drain_drops(1) == 1);
+    REQUIRE_INSTANCES(0);
+}
@@ -108,3 +108,65 @@ TEST_CASE("Weak")
         }
     }
 }
+
+struct Parent;
+
+struct Child {
+    Weak<Parent> parent;
+};
+
+struct Parent : public InstanceCounter {
+    explicit Parent(Rc<Child> child)
+        : child(std::move(child))
+    {
+    }
+
+    Rc<Child> child;
+};
+
+TEST_CASE("new_cyclic")
+{
+    SUBCASE("Passes a Weak to the value under construction")
+    {
+        MemoryGuard guard;
+        {
+            bool locked = true;
+            auto parent = new_cyclic<Parent>([&locked](const Weak<Parent> &self) {
+                locked = static_cast<bool>(self.lock());
+                return Parent(make_rc<Child>(Child{ self }));
+            });
+            REQUIRE(!locked);
+            REQUIRE(&*parent->child->parent.lock() == &*parent);
+            REQUIRE_INSTANCES(1);
+        }
+        REQUIRE_INSTANCES(0);
+    }
+
+    SUBCASE("Supports separately stored values")
+    {
+        MemoryGuard guard;
+
+        struct Large {
+            Weak<Large> self;
+            char data[2048];
+        };
+
+        auto large = new_cyclic<Large>([](const Weak<Large> &self) { return Large{ self, {} }; });
+        REQUIRE(&*large->self.lock() == &*large);
+    }
+
+    SUBCASE("Releases the memory if f throws")
+    {
+        MemoryGuard guard;
+
+        Weak<Parent> stored;
+        REQUIRE_THROWS_AS(new_cyclic<Parent>([&stored](const Weak<Parent> &self) -> Parent {
+            stored = self;
+            throw 42;
+        }),
+                          int);
+        REQUIRE(!stored.lock());
+        stored.reset();
+        REQUIRE_INSTANCES(0);
+    }
+}